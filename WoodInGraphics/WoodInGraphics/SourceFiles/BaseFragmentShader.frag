@@ -6,12 +6,17 @@ in vec3 ourColor;
 in vec2 texCoord;
 
 uniform sampler2D texture1;
+// Only sampled with BLEND_TEXTURE2
 uniform sampler2D texture2;
-uniform float arrowAlpha;
+#include "UniformBlocks.glsl"
 
 
 void main()
 {
+#ifdef BLEND_TEXTURE2
     fragColor = mix(texture(texture1, texCoord),
-                    texture(texture2, texCoord), arrowAlpha);
+                    texture(texture2, texCoord), arrowAlpha) * tint;
+#else
+    fragColor = texture(texture1, texCoord) * tint;
+#endif
 }
\ No newline at end of file
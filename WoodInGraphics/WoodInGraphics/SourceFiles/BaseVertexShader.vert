@@ -4,12 +4,14 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
 layout (location = 2) in vec2 aTexCoord;
 
+#include "UniformBlocks.glsl"
+
 out vec3 ourColor;
 out vec2 texCoord;
 
 void main()
 {
-	gl_Position = vec4(aPos, 1.0f);
+	gl_Position = viewProjection * vec4(aPos, 1.0f);
 	ourColor = aColor;
 	texCoord = aTexCoord;
 }
\ No newline at end of file
@@ -0,0 +1,481 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: BC1/BC3/BC7 block encoders. Endpoints come from the principal axis of each 4x4 block,
+/// which is fast and good enough for an offline bake. BC7 only uses mode 6 (one subset, RGBA endpoints).
+/// -----------------
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "BlockCompression.h"
+
+#pragma region Helpers
+
+/// <summary>
+/// Copies a 4x4 block out of the image, edges are clamped so sizes that are not a multiple of 4 work
+/// </summary>
+static void ExtractBlock(const RGBAImage& image, int blockX, int blockY, unsigned char block[16][4])
+{
+	for (int y = 0; y < 4; y++)
+	{
+		int sourceY = std::min(blockY * 4 + y, image.Height - 1);
+		for (int x = 0; x < 4; x++)
+		{
+			int sourceX = std::min(blockX * 4 + x, image.Width - 1);
+			memcpy(block[y * 4 + x], &image.Pixels[((size_t)sourceY * image.Width + sourceX) * 4], 4);
+		}
+	}
+}
+
+/// <summary>
+/// Finds the two ends of the line that best fits the block colors (principal axis through the mean)
+/// </summary>
+/// <param name="channels"> 3 to fit RGB only, 4 to include alpha </param>
+static void PrincipalAxisEndpoints(const unsigned char block[16][4], int channels, float endpoint0[4], float endpoint1[4])
+{
+	float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < channels; c++)
+		{
+			mean[c] += block[i][c] / 16.0f;
+		}
+	}
+
+	float covariance[4][4] = {};
+	for (int i = 0; i < 16; i++)
+	{
+		for (int a = 0; a < channels; a++)
+		{
+			for (int b = 0; b < channels; b++)
+			{
+				covariance[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+			}
+		}
+	}
+
+	// Power iteration converges on the largest eigenvector quickly for a 4x4 matrix
+	float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float length = 0.0f;
+		for (int a = 0; a < channels; a++)
+		{
+			for (int b = 0; b < channels; b++)
+			{
+				next[a] += covariance[a][b] * axis[b];
+			}
+			length = std::max(length, std::fabs(next[a]));
+		}
+		if (length < 1e-6f)
+		{
+			break;
+		}
+		for (int a = 0; a < channels; a++)
+		{
+			axis[a] = next[a] / length;
+		}
+	}
+
+	float minT = 0.0f;
+	float maxT = 0.0f;
+	float axisLengthSq = 0.0f;
+	for (int c = 0; c < channels; c++)
+	{
+		axisLengthSq += axis[c] * axis[c];
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		float t = 0.0f;
+		for (int c = 0; c < channels; c++)
+		{
+			t += (block[i][c] - mean[c]) * axis[c];
+		}
+		t /= std::max(axisLengthSq, 1e-6f);
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	for (int c = 0; c < 4; c++)
+	{
+		float value = (c < channels) ? mean[c] : 255.0f;
+		float direction = (c < channels) ? axis[c] : 0.0f;
+		endpoint0[c] = std::min(255.0f, std::max(0.0f, value + direction * maxT));
+		endpoint1[c] = std::min(255.0f, std::max(0.0f, value + direction * minT));
+	}
+}
+
+static int ColorDistanceSq(const unsigned char a[4], const int b[4], int channels)
+{
+	int distance = 0;
+	for (int c = 0; c < channels; c++)
+	{
+		int delta = (int)a[c] - b[c];
+		distance += delta * delta;
+	}
+	return distance;
+}
+
+static uint16_t PackRGB565(const float color[4])
+{
+	int r = std::min(31, (int)(color[0] * 31.0f / 255.0f + 0.5f));
+	int g = std::min(63, (int)(color[1] * 63.0f / 255.0f + 0.5f));
+	int b = std::min(31, (int)(color[2] * 31.0f / 255.0f + 0.5f));
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(uint16_t packed, int color[4])
+{
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+	color[3] = 255;
+}
+
+static void WriteLE16(unsigned char* output, uint16_t value)
+{
+	output[0] = (unsigned char)(value & 0xFF);
+	output[1] = (unsigned char)(value >> 8);
+}
+
+#pragma endregion Helpers
+
+#pragma region Block Encoders
+
+/// <summary>
+/// BC1 color block, always in 4 color mode so it never produces the punch through alpha
+/// </summary>
+static void EncodeColorBlock(const unsigned char block[16][4], unsigned char output[8])
+{
+	float endpoint0[4], endpoint1[4];
+	PrincipalAxisEndpoints(block, 3, endpoint0, endpoint1);
+
+	uint16_t color0 = PackRGB565(endpoint0);
+	uint16_t color1 = PackRGB565(endpoint1);
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		int palette[4][4];
+		UnpackRGB565(color0, palette[0]);
+		UnpackRGB565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0;
+			int bestDistance = ColorDistanceSq(block[i], palette[0], 3);
+			for (int p = 1; p < 4; p++)
+			{
+				int distance = ColorDistanceSq(block[i], palette[p], 3);
+				if (distance < bestDistance)
+				{
+					best = p;
+					bestDistance = distance;
+				}
+			}
+			indices |= (uint32_t)best << (i * 2);
+		}
+	}
+
+	WriteLE16(output, color0);
+	WriteLE16(output + 2, color1);
+	for (int i = 0; i < 4; i++)
+	{
+		output[4 + i] = (unsigned char)(indices >> (i * 8));
+	}
+}
+
+/// <summary>
+/// BC3 alpha block, 8 interpolated values between the block min and max
+/// </summary>
+static void EncodeAlphaBlock(const unsigned char block[16][4], unsigned char output[8])
+{
+	int alpha0 = 0;
+	int alpha1 = 255;
+	for (int i = 0; i < 16; i++)
+	{
+		alpha0 = std::max(alpha0, (int)block[i][3]);
+		alpha1 = std::min(alpha1, (int)block[i][3]);
+	}
+
+	uint64_t indices = 0;
+	if (alpha0 != alpha1)
+	{
+		int palette[8];
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		for (int p = 1; p < 7; p++)
+		{
+			palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0;
+			int bestDistance = 256;
+			for (int p = 0; p < 8; p++)
+			{
+				int distance = std::abs((int)block[i][3] - palette[p]);
+				if (distance < bestDistance)
+				{
+					best = p;
+					bestDistance = distance;
+				}
+			}
+			indices |= (uint64_t)best << (i * 3);
+		}
+	}
+
+	output[0] = (unsigned char)alpha0;
+	output[1] = (unsigned char)alpha1;
+	for (int i = 0; i < 6; i++)
+	{
+		output[2 + i] = (unsigned char)(indices >> (i * 8));
+	}
+}
+
+/// <summary>
+/// Writes bits into a 128 bit block, least significant bit first
+/// </summary>
+struct BitWriter
+{
+	unsigned char* Output;
+	int Position = 0;
+
+	void Write(uint32_t value, int bitCount)
+	{
+		for (int i = 0; i < bitCount; i++, Position++)
+		{
+			if ((value >> i) & 1u)
+			{
+				Output[Position / 8] |= (unsigned char)(1u << (Position % 8));
+			}
+		}
+	}
+};
+
+/// <summary>
+/// Splits an 8 bit endpoint into 7 bit channels plus a shared p-bit, picking whichever p-bit is closer
+/// </summary>
+static void QuantizeBC7Endpoint(const float endpoint[4], int quantized[4], int& pBit)
+{
+	int bestError = -1;
+	for (int p = 0; p < 2; p++)
+	{
+		int candidate[4];
+		int error = 0;
+		for (int c = 0; c < 4; c++)
+		{
+			candidate[c] = std::min(127, std::max(0, (int)std::lround((endpoint[c] - p) / 2.0f)));
+			int delta = ((candidate[c] << 1) | p) - (int)std::lround(endpoint[c]);
+			error += delta * delta;
+		}
+		if (bestError < 0 || error < bestError)
+		{
+			bestError = error;
+			pBit = p;
+			memcpy(quantized, candidate, sizeof(candidate));
+		}
+	}
+}
+
+/// <summary>
+/// BC7 mode 6: one subset, RGBA 7.7.7.7 endpoints with a p-bit each and 4 bit indices
+/// </summary>
+static void EncodeBC7Block(const unsigned char block[16][4], unsigned char output[16])
+{
+	static const int Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	float endpoint0[4], endpoint1[4];
+	PrincipalAxisEndpoints(block, 4, endpoint0, endpoint1);
+
+	int quantized[2][4];
+	int pBits[2];
+	QuantizeBC7Endpoint(endpoint0, quantized[0], pBits[0]);
+	QuantizeBC7Endpoint(endpoint1, quantized[1], pBits[1]);
+
+	int palette[16][4];
+	for (int w = 0; w < 16; w++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			int e0 = (quantized[0][c] << 1) | pBits[0];
+			int e1 = (quantized[1][c] << 1) | pBits[1];
+			palette[w][c] = ((64 - Weights[w]) * e0 + Weights[w] * e1 + 32) >> 6;
+		}
+	}
+
+	int indices[16];
+	for (int i = 0; i < 16; i++)
+	{
+		int best = 0;
+		int bestDistance = ColorDistanceSq(block[i], palette[0], 4);
+		for (int w = 1; w < 16; w++)
+		{
+			int distance = ColorDistanceSq(block[i], palette[w], 4);
+			if (distance < bestDistance)
+			{
+				best = w;
+				bestDistance = distance;
+			}
+		}
+		indices[i] = best;
+	}
+
+	// The first index is stored with its top bit dropped, so it has to be below 8
+	if (indices[0] >= 8)
+	{
+		std::swap(quantized[0], quantized[1]);
+		std::swap(pBits[0], pBits[1]);
+		for (int i = 0; i < 16; i++)
+		{
+			indices[i] = 15 - indices[i];
+		}
+	}
+
+	memset(output, 0, 16);
+	BitWriter writer{ output };
+	writer.Write(1u << 6, 7);
+	for (int c = 0; c < 4; c++)
+	{
+		writer.Write((uint32_t)quantized[0][c], 7);
+		writer.Write((uint32_t)quantized[1][c], 7);
+	}
+	writer.Write((uint32_t)pBits[0], 1);
+	writer.Write((uint32_t)pBits[1], 1);
+	writer.Write((uint32_t)indices[0], 3);
+	for (int i = 1; i < 16; i++)
+	{
+		writer.Write((uint32_t)indices[i], 4);
+	}
+}
+
+#pragma endregion Block Encoders
+
+size_t BlockBytes(BlockFormat format)
+{
+	return (format == BlockFormat::BC1) ? 8 : 16;
+}
+
+size_t CompressedSize(BlockFormat format, int width, int height)
+{
+	size_t blocksX = (size_t)(width + 3) / 4;
+	size_t blocksY = (size_t)(height + 3) / 4;
+	return blocksX * blocksY * BlockBytes(format);
+}
+
+/// <summary>
+/// Compresses one image (one mip level), blocks are written row by row
+/// </summary>
+std::vector<unsigned char> CompressImage(const RGBAImage& image, BlockFormat format)
+{
+	std::vector<unsigned char> output(CompressedSize(format, image.Width, image.Height));
+	int blocksX = (image.Width + 3) / 4;
+	int blocksY = (image.Height + 3) / 4;
+	size_t blockBytes = BlockBytes(format);
+
+	unsigned char block[16][4];
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			ExtractBlock(image, bx, by, block);
+			unsigned char* destination = &output[((size_t)by * blocksX + bx) * blockBytes];
+			switch (format)
+			{
+			case BlockFormat::BC1:
+				EncodeColorBlock(block, destination);
+				break;
+			case BlockFormat::BC3:
+				EncodeAlphaBlock(block, destination);
+				EncodeColorBlock(block, destination + 8);
+				break;
+			case BlockFormat::BC7:
+				EncodeBC7Block(block, destination);
+				break;
+			}
+		}
+	}
+	return output;
+}
+
+#pragma region Mip Generation
+
+static float SRGBToLinear(float value)
+{
+	value /= 255.0f;
+	return (value <= 0.04045f) ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSRGB(float value)
+{
+	value = (value <= 0.0031308f) ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	return value * 255.0f;
+}
+
+/// <summary>
+/// Halves the image with a 2x2 box filter. sRGB color is averaged in linear space so mips don't darken
+/// </summary>
+RGBAImage Downsample(const RGBAImage& image, bool srgb)
+{
+	RGBAImage result;
+	result.Width = std::max(1, image.Width / 2);
+	result.Height = std::max(1, image.Height / 2);
+	result.Pixels.resize((size_t)result.Width * result.Height * 4);
+
+	for (int y = 0; y < result.Height; y++)
+	{
+		for (int x = 0; x < result.Width; x++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				float sum = 0.0f;
+				for (int sy = 0; sy < 2; sy++)
+				{
+					int sourceY = std::min(y * 2 + sy, image.Height - 1);
+					for (int sx = 0; sx < 2; sx++)
+					{
+						int sourceX = std::min(x * 2 + sx, image.Width - 1);
+						float value = image.Pixels[((size_t)sourceY * image.Width + sourceX) * 4 + c];
+						sum += (srgb && c < 3) ? SRGBToLinear(value) : value;
+					}
+				}
+				float average = sum / 4.0f;
+				if (srgb && c < 3)
+				{
+					average = LinearToSRGB(average);
+				}
+				result.Pixels[((size_t)y * result.Width + x) * 4 + c] = (unsigned char)std::min(255.0f, average + 0.5f);
+			}
+		}
+	}
+	return result;
+}
+
+/// <summary>
+/// Full chain down to 1x1, level 0 is the image itself
+/// </summary>
+std::vector<RGBAImage> BuildMipChain(const RGBAImage& image, bool srgb)
+{
+	std::vector<RGBAImage> levels;
+	levels.push_back(image);
+	while (levels.back().Width > 1 || levels.back().Height > 1)
+	{
+		levels.push_back(Downsample(levels.back(), srgb));
+	}
+	return levels;
+}
+
+#pragma endregion Mip Generation
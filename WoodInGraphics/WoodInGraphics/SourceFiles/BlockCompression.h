@@ -0,0 +1,41 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: CPU encoders for the BC1, BC3 and BC7 block compressed formats plus mip chain generation.
+/// Used by the offline texture baker, none of this needs a GL context.
+/// -----------------
+
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <vector>
+
+#pragma endregion Includes
+
+enum class BlockFormat
+{
+	BC1,	// RGB, 8 bytes per 4x4 block
+	BC3,	// RGBA with interpolated alpha, 16 bytes per block
+	BC7		// RGBA, higher quality, 16 bytes per block (mode 6 only)
+};
+
+// Tightly packed 8 bit RGBA image
+struct RGBAImage
+{
+	int Width = 0;
+	int Height = 0;
+	std::vector<unsigned char> Pixels;
+};
+
+size_t BlockBytes(BlockFormat format);
+size_t CompressedSize(BlockFormat format, int width, int height);
+
+std::vector<unsigned char> CompressImage(const RGBAImage& image, BlockFormat format);
+
+RGBAImage Downsample(const RGBAImage& image, bool srgb);
+std::vector<RGBAImage> BuildMipChain(const RGBAImage& image, bool srgb);
+
+#endif // !BLOCK_COMPRESSION_H
@@ -0,0 +1,216 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Per job command recording and replay on the GL thread
+/// -----------------
+#include <condition_variable>
+#include <mutex>
+#include <new>
+
+#include "CommandBuffer.h"
+#include "MeshBatch.h"
+#include "Profiler.h"
+
+// Headers and payloads are all 8 byte aligned, enough for every payload below
+const size_t CommandAlignment = 8;
+const size_t CommandPayloadOffset = 8;
+
+#pragma region Payloads
+
+struct PacketCommand
+{
+	uint64_t Key;
+	DrawPacket Packet;
+};
+
+struct BatchCommand
+{
+	MeshBatch* Batch;
+	BatchMesh Mesh;
+	unsigned int Material;
+	InstanceData Instance;
+};
+
+#pragma endregion Payloads
+
+#pragma region Command Buffer
+
+/// <summary>
+/// Reserves a header and payload in the arena
+/// </summary>
+/// <returns> payload to fill in </returns>
+template<typename T>
+T* CommandBuffer::Append(CommandType type)
+{
+	static_assert(alignof(T) <= CommandAlignment, "Command payload needs a bigger alignment");
+	size_t size = CommandPayloadOffset + ((sizeof(T) + CommandAlignment - 1) & ~(CommandAlignment - 1));
+	unsigned char* memory = (unsigned char*)_arena.Allocate(size, CommandAlignment);
+	CommandHeader* header = (CommandHeader*)memory;
+	header->Type = type;
+	header->Size = (uint16_t)size;
+	_commandCount++;
+	return new (memory + CommandPayloadOffset) T();
+}
+
+void CommandBuffer::Submit(uint64_t key, const DrawPacket& packet)
+{
+	PacketCommand* command = Append<PacketCommand>(CommandType::SubmitPacket);
+	command->Key = key;
+	command->Packet = packet;
+}
+
+void CommandBuffer::DrawBatched(MeshBatch& batch, const BatchMesh& mesh, unsigned int material, const InstanceData& instance)
+{
+	BatchCommand* command = Append<BatchCommand>(CommandType::DrawBatched);
+	command->Batch = &batch;
+	command->Mesh = mesh;
+	command->Material = material;
+	command->Instance = instance;
+}
+
+/// <summary>
+/// Walks the arena in recording order, packets go into the queue and batch draws into their batch
+/// </summary>
+void CommandBuffer::Execute(RenderQueue& queue) const
+{
+	for (size_t chunk = 0; chunk < _arena.ChunkCount(); chunk++)
+	{
+		const unsigned char* data = _arena.ChunkData(chunk);
+		size_t used = _arena.ChunkUsed(chunk);
+		size_t offset = 0;
+		while (offset < used)
+		{
+			const CommandHeader* header = (const CommandHeader*)(data + offset);
+			const unsigned char* payload = data + offset + CommandPayloadOffset;
+			switch (header->Type)
+			{
+			case CommandType::SubmitPacket:
+			{
+				const PacketCommand* command = (const PacketCommand*)payload;
+				queue.Submit(command->Key, command->Packet);
+				break;
+			}
+			case CommandType::DrawBatched:
+			{
+				const BatchCommand* command = (const BatchCommand*)payload;
+				command->Batch->Draw(command->Mesh, command->Material, &command->Instance);
+				break;
+			}
+			}
+			offset += header->Size;
+		}
+	}
+}
+
+void CommandBuffer::Reset()
+{
+	_arena.Reset();
+	_commandCount = 0;
+}
+
+size_t CommandBuffer::CommandCount() const
+{
+	return _commandCount;
+}
+
+size_t CommandBuffer::BytesUsed() const
+{
+	return _arena.BytesUsed();
+}
+
+#pragma endregion Command Buffer
+
+#pragma region Command Recorder
+
+/// <param name="workerCount"> recording threads besides the caller, 0 records everything on the caller </param>
+CommandRecorder::CommandRecorder(unsigned int workerCount)
+{
+	// No idle pool when nobody asked for workers
+	if (workerCount > 0)
+	{
+		_workers.reset(new ThreadPool(workerCount));
+	}
+}
+
+/// <summary>
+/// Fork and join over the recording jobs, each job gets a buffer of its own so nothing is shared while recording
+/// </summary>
+/// <param name="jobCount"> number of buffers to record, usually a slice of the scene each </param>
+/// <param name="job"> records into the buffer it is given </param>
+void CommandRecorder::Record(unsigned int jobCount, const std::function<void(CommandBuffer&, unsigned int)>& job)
+{
+	while (_buffers.size() < jobCount)
+	{
+		_buffers.push_back(std::unique_ptr<CommandBuffer>(new CommandBuffer()));
+	}
+	_jobCount = jobCount;
+	for (unsigned int i = 0; i < jobCount; i++)
+	{
+		_buffers[i]->Reset();
+	}
+	if (jobCount == 0)
+	{
+		return;
+	}
+	if (!_workers)
+	{
+		ProfileZone zone("Record commands");
+		for (unsigned int i = 0; i < jobCount; i++)
+		{
+			job(*_buffers[i], i);
+		}
+		return;
+	}
+
+	// Waits on its own jobs only, the pool could have other work queued
+	std::mutex mutex;
+	std::condition_variable finished;
+	unsigned int remaining = jobCount - 1;
+	for (unsigned int i = 1; i < jobCount; i++)
+	{
+		CommandBuffer* buffer = _buffers[i].get();
+		_workers->Submit([&, buffer, i]()
+		{
+			{
+				ProfileZone zone("Record commands");
+				job(*buffer, i);
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--remaining == 0)
+			{
+				finished.notify_one();
+			}
+		});
+	}
+	{
+		ProfileZone zone("Record commands");
+		job(*_buffers[0], 0);
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [&]() { return remaining == 0; });
+}
+
+void CommandRecorder::Execute(RenderQueue& queue)
+{
+	ProfileZone zone("Replay commands");
+	for (unsigned int i = 0; i < _jobCount; i++)
+	{
+		_buffers[i]->Execute(queue);
+	}
+}
+
+unsigned int CommandRecorder::WorkerCount() const
+{
+	return _workers ? _workers->ThreadCount() : 0;
+}
+
+size_t CommandRecorder::BytesRecorded() const
+{
+	size_t bytes = 0;
+	for (unsigned int i = 0; i < _jobCount; i++)
+	{
+		bytes += _buffers[i]->BytesUsed();
+	}
+	return bytes;
+}
+
+#pragma endregion Command Recorder
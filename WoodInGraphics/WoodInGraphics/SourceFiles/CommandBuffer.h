@@ -0,0 +1,103 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Draw commands recorded away from the GL thread. A CommandBuffer writes plain data (sort keyed packets
+/// and mesh batch draws) into its own linear arena, nothing in it touches GL so any thread can record.
+/// CommandRecorder hands one buffer to each recording job, runs the jobs across its workers and then replays every
+/// buffer on the GL thread in job order, so the result does not depend on which worker ran what.
+/// Packets go into a RenderQueue while replaying, so draws from every job are sorted together. Batch draws go into
+/// their MeshBatch in recording order, the caller flushes it.
+/// -----------------
+
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+#pragma region Includes
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "LinearArena.h"
+#include "RenderQueue.h"
+#include "ThreadPool.h"
+
+#pragma endregion Includes
+
+class MeshBatch;
+struct BatchMesh;
+struct InstanceData;
+
+enum class CommandType : uint16_t
+{
+	SubmitPacket,
+	DrawBatched
+};
+
+class CommandBuffer
+{
+public:
+
+	CommandBuffer() = default;
+
+	CommandBuffer(const CommandBuffer&) = delete;
+	CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+	// Goes into the render queue when replayed and is drawn in key order with everything else
+	void Submit(uint64_t key, const DrawPacket& packet);
+	// One instance, copied. Queued with batch.Draw when replayed, the batch has to outlive the replay
+	void DrawBatched(MeshBatch& batch, const BatchMesh& mesh, unsigned int material, const InstanceData& instance);
+
+	// GL thread only
+	void Execute(RenderQueue& queue) const;
+	void Reset();
+
+	size_t CommandCount() const;
+	size_t BytesUsed() const;
+
+private:
+
+	struct CommandHeader
+	{
+		CommandType Type;
+		// Header plus payload, padded so the next header stays aligned
+		uint16_t Size;
+	};
+
+	LinearArena _arena;
+	size_t _commandCount = 0;
+
+	template<typename T>
+	T* Append(CommandType type);
+};
+
+class CommandRecorder
+{
+public:
+
+	// workerCount recording threads besides the caller, 0 records every job on the calling thread
+	explicit CommandRecorder(unsigned int workerCount);
+
+	CommandRecorder(const CommandRecorder&) = delete;
+	CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+	// Runs job(buffer, index) for every index, job 0 on the calling thread and the rest on the workers (if there are
+	// any), and returns once they have all finished. Jobs must not use GL
+	void Record(unsigned int jobCount, const std::function<void(CommandBuffer&, unsigned int)>& job);
+
+	// GL thread only. Replays the buffers from the last Record in job order
+	void Execute(RenderQueue& queue);
+
+	size_t BytesRecorded() const;
+	unsigned int WorkerCount() const;
+
+private:
+
+	// Null without workers
+	std::unique_ptr<ThreadPool> _workers;
+	std::vector<std::unique_ptr<CommandBuffer>> _buffers;
+	unsigned int _jobCount = 0;
+};
+
+#endif // !COMMAND_BUFFER_H
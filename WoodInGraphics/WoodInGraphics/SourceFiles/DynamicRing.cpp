@@ -0,0 +1,236 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Fenced, triple buffered ring for per frame vertex, index and uniform data
+/// -----------------
+#include <glad/glad.h>
+
+#include <iostream>
+
+#include "DynamicRing.h"
+#include "GLStateCache.h"
+#include "Profiler.h"
+
+// Enough for any vertex attribute or index type
+const size_t DynamicDefaultAlignment = 16;
+
+DynamicRing::~DynamicRing()
+{
+	Destroy();
+}
+
+/// <summary>
+/// Creates the buffer, persistently mapped when the driver supports it.
+/// Bound through GL_COPY_WRITE_BUFFER so creating or mapping it never disturbs a vertex array's element buffer
+/// </summary>
+/// <param name="frameBytes"> most one frame can allocate </param>
+/// <param name="allowPersistent"> false forces the 3.3 path </param>
+/// <returns> false if the buffer could not be created or mapped </returns>
+bool DynamicRing::Create(size_t frameBytes, bool allowPersistent)
+{
+	Destroy();
+	_frameBytes = frameBytes;
+	_persistent = allowPersistent && GLAD_GL_ARB_buffer_storage != 0;
+	_frame = 0;
+	_cursor = 0;
+	_flushed = 0;
+	GLint uniformAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	if (uniformAlignment > 0)
+	{
+		_uniformAlignment = (size_t)uniformAlignment;
+	}
+
+	GLsizeiptr capacity = (GLsizeiptr)(frameBytes * DynamicFramesInFlight);
+	GLStateCache& state = GLStateCache::Instance();
+	glGenBuffers(1, &_buffer);
+	state.BindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+	if (_persistent)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, capacity, NULL, flags);
+		_mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, capacity, flags);
+		if (!_mapped)
+		{
+			std::cout << "ERROR::DYNAMIC_RING::PERSISTENT_MAP_FAILED" << std::endl;
+			state.BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			Destroy();
+			return false;
+		}
+	}
+	else
+	{
+		glBufferData(GL_COPY_WRITE_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+	}
+	state.BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return true;
+}
+
+/// <summary>
+/// Waits for every fence and deletes the buffer
+/// </summary>
+void DynamicRing::Destroy()
+{
+	for (void*& fence : _fences)
+	{
+		if (fence)
+		{
+			glClientWaitSync((GLsync)fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			glDeleteSync((GLsync)fence);
+			fence = nullptr;
+		}
+	}
+	if (_buffer != 0)
+	{
+		Unmap();
+		GLStateCache::Instance().DeleteBuffer(_buffer);
+		_buffer = 0;
+	}
+	_frameBytes = 0;
+}
+
+bool DynamicRing::IsPersistent() const
+{
+	return _persistent;
+}
+
+unsigned int DynamicRing::GetBufferID() const
+{
+	return _buffer;
+}
+
+size_t DynamicRing::GetUniformAlignment() const
+{
+	return _uniformAlignment;
+}
+
+/// <summary>
+/// Starts writing into this frame's region, blocking only if the GPU is still reading it
+/// </summary>
+void DynamicRing::BeginFrame()
+{
+	void*& fence = _fences[_frame];
+	if (fence)
+	{
+		GLenum result = glClientWaitSync((GLsync)fence, 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+		{
+			ProfileZone zone("Dynamic ring stall");
+			_stalls++;
+			glClientWaitSync((GLsync)fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		}
+		glDeleteSync((GLsync)fence);
+		fence = nullptr;
+	}
+	_cursor = 0;
+	_flushed = 0;
+}
+
+/// <summary>
+/// Bump allocates from this frame's region
+/// </summary>
+/// <param name="size"> bytes needed </param>
+/// <param name="alignment"> offset alignment in bytes, vertex data drawn with a base vertex wants its stride </param>
+/// <param name="allocation"> filled with the region on success </param>
+/// <returns> false when the frame has used its whole region </returns>
+bool DynamicRing::Allocate(size_t size, size_t alignment, DynamicAllocation& allocation)
+{
+	if (_buffer == 0 || size == 0)
+	{
+		return false;
+	}
+	if (alignment == 0)
+	{
+		alignment = DynamicDefaultAlignment;
+	}
+	// Aligned against the buffer start, regions are not necessarily a multiple of every alignment
+	size_t offset = (RegionStart() + _cursor + alignment - 1) / alignment * alignment - RegionStart();
+	if (offset + size > _frameBytes)
+	{
+		return false;
+	}
+
+	if (!_persistent && !_mapped)
+	{
+		// The rest of the region, nothing the GPU may still read is in it so the driver can skip syncing
+		GLStateCache::Instance().BindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+		_mapStart = RegionStart() + _cursor;
+		_mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, (GLintptr)_mapStart, (GLsizeiptr)(_frameBytes - _cursor),
+			GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+		if (!_mapped)
+		{
+			std::cout << "ERROR::DYNAMIC_RING::MAP_FAILED" << std::endl;
+			return false;
+		}
+		_flushed = _cursor;
+	}
+
+	_cursor = offset + size;
+	allocation.Offset = RegionStart() + offset;
+	allocation.Memory = _mapped + (allocation.Offset - (_persistent ? 0 : _mapStart));
+	return true;
+}
+
+/// <summary>
+/// Allocates at the driver's uniform buffer offset alignment, ready for glBindBufferRange
+/// </summary>
+bool DynamicRing::AllocateUniforms(size_t size, DynamicAllocation& allocation)
+{
+	return Allocate(size, _uniformAlignment, allocation);
+}
+
+/// <summary>
+/// Flushes and unmaps the 3.3 mapping, nothing to do for the coherent persistent one
+/// </summary>
+void DynamicRing::Flush()
+{
+	if (_persistent || !_mapped)
+	{
+		return;
+	}
+	GLStateCache::Instance().BindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+	glFlushMappedBufferRange(GL_COPY_WRITE_BUFFER, (GLintptr)(RegionStart() + _flushed - _mapStart), (GLsizeiptr)(_cursor - _flushed));
+	Unmap();
+}
+
+/// <summary>
+/// Fences this frame's region and moves on to the next one
+/// </summary>
+void DynamicRing::EndFrame()
+{
+	if (_buffer == 0)
+	{
+		return;
+	}
+	Flush();
+	_fences[_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	_lastFrameBytes = _cursor;
+	Profiler::Instance().CountUploadBytes(_cursor);
+	_frame = (_frame + 1) % DynamicFramesInFlight;
+	_cursor = 0;
+	_flushed = 0;
+}
+
+size_t DynamicRing::LastFrameBytes() const
+{
+	return _lastFrameBytes;
+}
+
+unsigned long long DynamicRing::StallCount() const
+{
+	return _stalls;
+}
+
+size_t DynamicRing::RegionStart() const
+{
+	return _frame * _frameBytes;
+}
+
+void DynamicRing::Unmap()
+{
+	if (_mapped)
+	{
+		GLStateCache::Instance().BindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		_mapped = nullptr;
+	}
+}
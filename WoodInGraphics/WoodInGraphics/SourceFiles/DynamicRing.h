@@ -0,0 +1,88 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: One big buffer for data that changes every frame (vertices, indices, uniform blocks), split into
+/// DynamicFramesInFlight regions. Each frame bump-allocates out of its own region and fences it at the end, a region
+/// is only written again once its fence from DynamicFramesInFlight frames ago has passed, so the driver never has to
+/// synchronize or reallocate anything.
+/// With GL_ARB_buffer_storage the buffer is persistently and coherently mapped for its whole life. On plain 3.3 the
+/// rest of the frame's region is mapped unsynchronized on the first allocation and Flush unmaps it before drawing,
+/// the fences are what make skipping the driver's synchronization safe.
+/// -----------------
+
+#ifndef DYNAMIC_RING_H
+#define DYNAMIC_RING_H
+
+#pragma region Includes
+
+#include <cstddef>
+
+#pragma endregion Includes
+
+// Frames the CPU may run ahead of the GPU before BeginFrame waits
+const unsigned int DynamicFramesInFlight = 3;
+
+// Region handed out by Allocate, Offset is from the start of the buffer
+struct DynamicAllocation
+{
+	size_t Offset = 0;
+	unsigned char* Memory = nullptr;
+};
+
+class DynamicRing
+{
+public:
+
+	DynamicRing() = default;
+	~DynamicRing();
+
+	DynamicRing(const DynamicRing&) = delete;
+	DynamicRing& operator=(const DynamicRing&) = delete;
+
+	// GL thread only. frameBytes is what one frame can allocate, the buffer is DynamicFramesInFlight times that
+	bool Create(size_t frameBytes, bool allowPersistent = true);
+	void Destroy();
+
+	bool IsPersistent() const;
+	unsigned int GetBufferID() const;
+	// glBindBufferRange offsets have to be a multiple of this
+	size_t GetUniformAlignment() const;
+
+	// Waits for the region's fence from DynamicFramesInFlight frames ago (it has normally passed long since)
+	void BeginFrame();
+	// alignment 0 means 16. Returns false when the frame's region is full
+	bool Allocate(size_t size, size_t alignment, DynamicAllocation& allocation);
+	bool AllocateUniforms(size_t size, DynamicAllocation& allocation);
+	// Makes everything allocated so far visible to draws, needed before drawing from the ring on the 3.3 path
+	void Flush();
+	// Flushes and fences the frame's region
+	void EndFrame();
+
+	// Bytes allocated last frame and how many BeginFrames had to block on the GPU
+	size_t LastFrameBytes() const;
+	unsigned long long StallCount() const;
+
+private:
+
+	unsigned int _buffer = 0;
+	size_t _frameBytes = 0;
+	size_t _uniformAlignment = 256;
+	bool _persistent = false;
+	// Persistent mapping of the whole buffer, or on 3.3 the current mapping starting at _mapStart
+	unsigned char* _mapped = nullptr;
+	size_t _mapStart = 0;
+
+	unsigned int _frame = 0;
+	// Offset into the current frame's region
+	size_t _cursor = 0;
+	// Start of what the 3.3 mapping has not flushed yet
+	size_t _flushed = 0;
+	size_t _lastFrameBytes = 0;
+	unsigned long long _stalls = 0;
+	void* _fences[DynamicFramesInFlight] = {};
+
+	size_t RegionStart() const;
+	void Unmap();
+};
+
+#endif // !DYNAMIC_RING_H
@@ -0,0 +1,155 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Directory change notifications, inotify or write time polling
+/// -----------------
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif // __linux__
+
+#include <algorithm>
+#include <iostream>
+
+#include "FileWatcher.h"
+
+#ifndef __linux__
+// How often the fallback rescans, often enough to feel immediate while costing nothing
+const std::chrono::milliseconds FileWatcherScanInterval(250);
+#endif // !__linux__
+
+FileWatcher::FileWatcher()
+{
+#ifdef __linux__
+	_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_inotify < 0)
+	{
+		std::cout << "ERROR::FILE_WATCHER::INOTIFY_INIT_FAILED" << std::endl;
+	}
+#else
+	_lastScan = std::chrono::steady_clock::now();
+#endif // __linux__
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+	if (_inotify >= 0)
+	{
+		close(_inotify);
+	}
+#endif // __linux__
+}
+
+/// <summary>
+/// Starts reporting changes to files directly in directory
+/// </summary>
+/// <returns> false if the directory does not exist or the watch could not be added </returns>
+bool FileWatcher::WatchDirectory(const std::string& directory)
+{
+#ifdef __linux__
+	if (_inotify < 0)
+	{
+		return false;
+	}
+	// Close after writing covers saving in place, moved to covers saving to a temporary and renaming it
+	int watch = inotify_add_watch(_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (watch < 0)
+	{
+		std::cout << "ERROR::FILE_WATCHER::CANNOT_WATCH " << directory << std::endl;
+		return false;
+	}
+	_directories[watch] = directory;
+	return true;
+#else
+	std::error_code error;
+	if (!std::filesystem::is_directory(directory, error))
+	{
+		std::cout << "ERROR::FILE_WATCHER::CANNOT_WATCH " << directory << std::endl;
+		return false;
+	}
+	_directories.push_back(directory);
+	// Record the current times so only later writes count
+	Scan(directory, nullptr);
+	return true;
+#endif // __linux__
+}
+
+/// <summary>
+/// Collects what changed since the last call
+/// </summary>
+/// <param name="changed"> cleared, then filled with the changed paths </param>
+void FileWatcher::Poll(std::vector<std::string>& changed)
+{
+	changed.clear();
+#ifdef __linux__
+	if (_inotify < 0)
+	{
+		return;
+	}
+	alignas(inotify_event) char buffer[4096];
+	while (true)
+	{
+		ssize_t length = read(_inotify, buffer, sizeof(buffer));
+		if (length <= 0)
+		{
+			// EAGAIN, nothing more queued
+			break;
+		}
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const inotify_event* event = (const inotify_event*)(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+			auto directory = _directories.find(event->wd);
+			if (event->len == 0 || directory == _directories.end())
+			{
+				continue;
+			}
+			std::string path = directory->second + "/" + event->name;
+			// An editor's save is often several events for the one file
+			if (std::find(changed.begin(), changed.end(), path) == changed.end())
+			{
+				changed.push_back(path);
+			}
+		}
+	}
+#else
+	auto now = std::chrono::steady_clock::now();
+	if (now - _lastScan < FileWatcherScanInterval)
+	{
+		return;
+	}
+	_lastScan = now;
+	for (const std::string& directory : _directories)
+	{
+		Scan(directory, &changed);
+	}
+#endif // __linux__
+}
+
+#ifndef __linux__
+/// <summary>
+/// Compares every file's write time with the last scan, changed gets the newer ones (skipped when null)
+/// </summary>
+void FileWatcher::Scan(const std::string& directory, std::vector<std::string>* changed)
+{
+	std::error_code error;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		if (!entry.is_regular_file(error))
+		{
+			continue;
+		}
+		std::string path = directory + "/" + entry.path().filename().string();
+		std::filesystem::file_time_type writeTime = entry.last_write_time(error);
+		auto known = _writeTimes.find(path);
+		if (known == _writeTimes.end() || known->second != writeTime)
+		{
+			if (changed && known != _writeTimes.end())
+			{
+				changed->push_back(path);
+			}
+			_writeTimes[path] = writeTime;
+		}
+	}
+}
+#endif // !__linux__
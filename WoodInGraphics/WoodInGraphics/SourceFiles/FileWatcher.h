@@ -0,0 +1,53 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Reports files that changed in watched directories. On Linux this is inotify on the directories
+/// (not the files, editors that save by writing a new file and renaming it over the old one would drop a file
+/// watch), read without blocking. Elsewhere the directories are rescanned for newer write times a few times a second.
+/// -----------------
+
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#pragma region Includes
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#pragma endregion Includes
+
+class FileWatcher
+{
+public:
+
+	FileWatcher();
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// Not recursive. False if the directory can't be watched
+	bool WatchDirectory(const std::string& directory);
+
+	// Never blocks. Fills changed with the paths (directory/name, as watched) written since the last call, each once
+	void Poll(std::vector<std::string>& changed);
+
+private:
+
+#ifdef __linux__
+	int _inotify = -1;
+	// inotify watch descriptor -> directory
+	std::unordered_map<int, std::string> _directories;
+#else
+	std::vector<std::string> _directories;
+	std::unordered_map<std::string, std::filesystem::file_time_type> _writeTimes;
+	std::chrono::steady_clock::time_point _lastScan;
+
+	void Scan(const std::string& directory, std::vector<std::string>* changed);
+#endif // __linux__
+};
+
+#endif // !FILE_WATCHER_H
@@ -0,0 +1,450 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Redundant GL call filter
+/// -----------------
+#include <glad/glad.h>
+
+#include <cstring>
+
+#include "GLStateCache.h"
+
+/// <summary>
+/// Column of _textures for a texture target
+/// </summary>
+/// <returns> -1 for targets that are not tracked </returns>
+static int TextureTargetSlot(unsigned int target)
+{
+	switch (target)
+	{
+	case GL_TEXTURE_2D: return 0;
+	case GL_TEXTURE_CUBE_MAP: return 1;
+	case GL_TEXTURE_2D_ARRAY: return 2;
+	case GL_TEXTURE_3D: return 3;
+	default: return -1;
+	}
+}
+
+GLStateCache& GLStateCache::Instance()
+{
+	static GLStateCache cache;
+	return cache;
+}
+
+GLStateCache::GLStateCache()
+{
+	Invalidate();
+}
+
+void GLStateCache::Invalidate()
+{
+	_program = Unknown;
+	_vertexArray = Unknown;
+	_activeUnit = Unknown;
+	for (unsigned int unit = 0; unit < StateCacheTextureUnits; unit++)
+	{
+		for (unsigned int slot = 0; slot < 4; slot++)
+		{
+			_textures[unit][slot] = Unknown;
+		}
+	}
+	_buffers.clear();
+	_bufferRanges.clear();
+	_capabilities.clear();
+	_pixelStore.clear();
+	_blendSource = Unknown;
+	_blendDestination = Unknown;
+	_depthFunc = Unknown;
+	_depthMask = Unknown;
+	_cullFace = Unknown;
+	_polygonMode = Unknown;
+	_clearColorKnown = false;
+	_viewportKnown = false;
+	_uniforms.clear();
+}
+
+bool GLStateCache::Changed(unsigned int& stored, unsigned int value)
+{
+	if (stored == value)
+	{
+		_filtered++;
+		return false;
+	}
+	stored = value;
+	_issued++;
+	return true;
+}
+
+bool GLStateCache::Changed(std::vector<KeyValue>& table, unsigned int key, unsigned int value)
+{
+	for (KeyValue& entry : table)
+	{
+		if (entry.Key == key)
+		{
+			return Changed(entry.Value, value);
+		}
+	}
+	table.push_back({ key, value });
+	_issued++;
+	return true;
+}
+
+#pragma region Bindings
+
+void GLStateCache::UseProgram(unsigned int program)
+{
+	if (Changed(_program, program))
+	{
+		glUseProgram(program);
+	}
+}
+
+void GLStateCache::BindVertexArray(unsigned int vertexArray)
+{
+	if (Changed(_vertexArray, vertexArray))
+	{
+		glBindVertexArray(vertexArray);
+		// The element buffer binding is part of the vertex array
+		for (KeyValue& entry : _buffers)
+		{
+			if (entry.Key == GL_ELEMENT_ARRAY_BUFFER)
+			{
+				entry.Value = Unknown;
+			}
+		}
+	}
+}
+
+void GLStateCache::BindBuffer(unsigned int target, unsigned int buffer)
+{
+	if (Changed(_buffers, target, buffer))
+	{
+		glBindBuffer(target, buffer);
+	}
+}
+
+/// <summary>
+/// Binds a range of buffer to an indexed binding point, filtered on the whole (buffer, offset, size)
+/// </summary>
+void GLStateCache::BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size)
+{
+	BufferRange* range = nullptr;
+	for (BufferRange& entry : _bufferRanges)
+	{
+		if (entry.Target == target && entry.Index == index)
+		{
+			range = &entry;
+			break;
+		}
+	}
+	if (range && range->Buffer == buffer && range->Offset == offset && range->Size == size)
+	{
+		_filtered++;
+		return;
+	}
+	if (!range)
+	{
+		_bufferRanges.push_back({ target, index, Unknown, 0, 0 });
+		range = &_bufferRanges.back();
+	}
+	range->Buffer = buffer;
+	range->Offset = offset;
+	range->Size = size;
+	_issued++;
+	glBindBufferRange(target, index, buffer, (GLintptr)offset, (GLsizeiptr)size);
+
+	// The generic binding changed too
+	for (KeyValue& entry : _buffers)
+	{
+		if (entry.Key == target)
+		{
+			entry.Value = buffer;
+			return;
+		}
+	}
+	_buffers.push_back({ target, buffer });
+}
+
+/// <summary>
+/// Makes texture unit (GL_TEXTURE0 + unit) active
+/// </summary>
+void GLStateCache::ActiveTexture(unsigned int unit)
+{
+	if (Changed(_activeUnit, unit))
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+}
+
+/// <summary>
+/// Binds a texture to a unit, the active unit only changes if the bind is actually needed
+/// </summary>
+void GLStateCache::BindTexture(unsigned int unit, unsigned int target, unsigned int texture)
+{
+	int slot = TextureTargetSlot(target);
+	if (unit >= StateCacheTextureUnits || slot < 0)
+	{
+		ActiveTexture(unit);
+		glBindTexture(target, texture);
+		_issued++;
+		return;
+	}
+	if (_textures[unit][slot] == texture)
+	{
+		_filtered++;
+		return;
+	}
+	ActiveTexture(unit);
+	_textures[unit][slot] = texture;
+	glBindTexture(target, texture);
+	_issued++;
+}
+
+void GLStateCache::BindTexture(unsigned int target, unsigned int texture)
+{
+	BindTexture(_activeUnit == Unknown ? 0 : _activeUnit, target, texture);
+}
+
+#pragma endregion Bindings
+
+#pragma region Fixed Function State
+
+/// <summary>
+/// glEnable / glDisable
+/// </summary>
+void GLStateCache::SetCapability(unsigned int capability, bool enabled)
+{
+	if (Changed(_capabilities, capability, enabled ? 1u : 0u))
+	{
+		if (enabled)
+		{
+			glEnable(capability);
+		}
+		else
+		{
+			glDisable(capability);
+		}
+	}
+}
+
+void GLStateCache::BlendFunc(unsigned int source, unsigned int destination)
+{
+	if (_blendSource == source && _blendDestination == destination)
+	{
+		_filtered++;
+		return;
+	}
+	_blendSource = source;
+	_blendDestination = destination;
+	glBlendFunc(source, destination);
+	_issued++;
+}
+
+void GLStateCache::DepthFunc(unsigned int function)
+{
+	if (Changed(_depthFunc, function))
+	{
+		glDepthFunc(function);
+	}
+}
+
+void GLStateCache::DepthMask(bool write)
+{
+	if (Changed(_depthMask, write ? 1u : 0u))
+	{
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void GLStateCache::CullFace(unsigned int face)
+{
+	if (Changed(_cullFace, face))
+	{
+		glCullFace(face);
+	}
+}
+
+/// <summary>
+/// Core profile only has GL_FRONT_AND_BACK, so that is the only face tracked
+/// </summary>
+void GLStateCache::PolygonMode(unsigned int mode)
+{
+	if (Changed(_polygonMode, mode))
+	{
+		glPolygonMode(GL_FRONT_AND_BACK, mode);
+	}
+}
+
+void GLStateCache::ClearColor(float r, float g, float b, float a)
+{
+	const float color[4] = { r, g, b, a };
+	if (_clearColorKnown && memcmp(color, _clearColor, sizeof(color)) == 0)
+	{
+		_filtered++;
+		return;
+	}
+	memcpy(_clearColor, color, sizeof(color));
+	_clearColorKnown = true;
+	glClearColor(r, g, b, a);
+	_issued++;
+}
+
+void GLStateCache::Viewport(int x, int y, int width, int height)
+{
+	const int viewport[4] = { x, y, width, height };
+	if (_viewportKnown && memcmp(viewport, _viewport, sizeof(viewport)) == 0)
+	{
+		_filtered++;
+		return;
+	}
+	memcpy(_viewport, viewport, sizeof(viewport));
+	_viewportKnown = true;
+	glViewport(x, y, width, height);
+	_issued++;
+}
+
+void GLStateCache::PixelStore(unsigned int parameter, int value)
+{
+	if (Changed(_pixelStore, parameter, (unsigned int)value))
+	{
+		glPixelStorei(parameter, value);
+	}
+}
+
+#pragma endregion Fixed Function State
+
+#pragma region Uniforms
+
+/// <summary>
+/// Uniform values live in the program, so they are shadowed per program
+/// </summary>
+bool GLStateCache::UniformChanged(int location, uint32_t bits)
+{
+	if (location < 0)
+	{
+		// glUniform ignores -1 anyway
+		_filtered++;
+		return false;
+	}
+	if (_program == Unknown)
+	{
+		_issued++;
+		return true;
+	}
+	std::unordered_map<int, uint32_t>& values = _uniforms[_program];
+	auto existing = values.find(location);
+	if (existing != values.end() && existing->second == bits)
+	{
+		_filtered++;
+		return false;
+	}
+	values[location] = bits;
+	_issued++;
+	return true;
+}
+
+void GLStateCache::Uniform1i(int location, int value)
+{
+	if (UniformChanged(location, (uint32_t)value))
+	{
+		glUniform1i(location, value);
+	}
+}
+
+void GLStateCache::Uniform1f(int location, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	if (UniformChanged(location, bits))
+	{
+		glUniform1f(location, value);
+	}
+}
+
+#pragma endregion Uniforms
+
+#pragma region Deletion
+
+void GLStateCache::DeleteProgram(unsigned int program)
+{
+	glDeleteProgram(program);
+	_uniforms.erase(program);
+	if (_program == program)
+	{
+		// Stays in use until something else is bound, simplest to just not trust it
+		_program = Unknown;
+	}
+}
+
+void GLStateCache::DeleteVertexArray(unsigned int vertexArray)
+{
+	glDeleteVertexArrays(1, &vertexArray);
+	if (_vertexArray == vertexArray)
+	{
+		// Deleting the bound vertex array binds 0
+		_vertexArray = 0;
+		for (KeyValue& entry : _buffers)
+		{
+			if (entry.Key == GL_ELEMENT_ARRAY_BUFFER)
+			{
+				entry.Value = Unknown;
+			}
+		}
+	}
+}
+
+void GLStateCache::DeleteBuffer(unsigned int buffer)
+{
+	glDeleteBuffers(1, &buffer);
+	for (KeyValue& entry : _buffers)
+	{
+		if (entry.Value == buffer)
+		{
+			entry.Value = 0;
+		}
+	}
+	// Deleting unbinds it from the indexed points as well
+	for (BufferRange& range : _bufferRanges)
+	{
+		if (range.Buffer == buffer)
+		{
+			range.Buffer = 0;
+			range.Offset = 0;
+			range.Size = 0;
+		}
+	}
+}
+
+void GLStateCache::DeleteTexture(unsigned int texture)
+{
+	glDeleteTextures(1, &texture);
+	for (unsigned int unit = 0; unit < StateCacheTextureUnits; unit++)
+	{
+		for (unsigned int slot = 0; slot < 4; slot++)
+		{
+			if (_textures[unit][slot] == texture)
+			{
+				_textures[unit][slot] = 0;
+			}
+		}
+	}
+}
+
+#pragma endregion Deletion
+
+void GLStateCache::EndFrame()
+{
+	_lastIssued = _issued;
+	_lastFiltered = _filtered;
+	_issued = 0;
+	_filtered = 0;
+}
+
+unsigned int GLStateCache::LastFrameIssued() const
+{
+	return _lastIssued;
+}
+
+unsigned int GLStateCache::LastFrameFiltered() const
+{
+	return _lastFiltered;
+}
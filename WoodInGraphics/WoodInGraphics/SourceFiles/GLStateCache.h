@@ -0,0 +1,127 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Shadow copy of the GL state the renderer touches. Every setter compares against the shadow and
+/// only calls GL when the value actually changes, so code can set the state it needs without tracking what is
+/// already bound. All binds have to go through here (or be followed by Invalidate) or the shadow goes stale.
+/// Objects must be deleted through here too, GL reuses names and a stale shadow would skip binding the new object.
+/// -----------------
+
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#pragma endregion Includes
+
+// Texture units the cache tracks, binds to higher units still work but are always issued
+const unsigned int StateCacheTextureUnits = 16;
+
+class GLStateCache
+{
+public:
+
+	static GLStateCache& Instance();
+
+	GLStateCache(const GLStateCache&) = delete;
+	GLStateCache& operator=(const GLStateCache&) = delete;
+
+	// Forgets everything, the next call of each setter goes to GL. Use after code that bypasses the cache
+	void Invalidate();
+
+	void UseProgram(unsigned int program);
+	void BindVertexArray(unsigned int vertexArray);
+	void BindBuffer(unsigned int target, unsigned int buffer);
+	// Indexed binding (uniform blocks), like GL it also binds the buffer to target
+	void BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size);
+	void BindTexture(unsigned int unit, unsigned int target, unsigned int texture);
+	// Binds on whichever unit is active, for creating and editing textures
+	void BindTexture(unsigned int target, unsigned int texture);
+	void ActiveTexture(unsigned int unit);
+
+	void SetCapability(unsigned int capability, bool enabled);
+	void BlendFunc(unsigned int source, unsigned int destination);
+	void DepthFunc(unsigned int function);
+	void DepthMask(bool write);
+	void CullFace(unsigned int face);
+	void PolygonMode(unsigned int mode);
+	void ClearColor(float r, float g, float b, float a);
+	void Viewport(int x, int y, int width, int height);
+	void PixelStore(unsigned int parameter, int value);
+
+	// Uniforms of the program bound through UseProgram
+	void Uniform1i(int location, int value);
+	void Uniform1f(int location, float value);
+
+	void DeleteProgram(unsigned int program);
+	void DeleteVertexArray(unsigned int vertexArray);
+	void DeleteBuffer(unsigned int buffer);
+	void DeleteTexture(unsigned int texture);
+
+	// Rolls the per frame counters over
+	void EndFrame();
+	unsigned int LastFrameIssued() const;
+	unsigned int LastFrameFiltered() const;
+
+private:
+
+	// Marks a value the cache does not know, it never matches a real one
+	static const unsigned int Unknown = 0xFFFFFFFFu;
+
+	struct BufferRange
+	{
+		unsigned int Target;
+		unsigned int Index;
+		unsigned int Buffer;
+		size_t Offset;
+		size_t Size;
+	};
+
+	// Small (key, value) tables, there are only ever a handful of entries so a linear search wins
+	struct KeyValue
+	{
+		unsigned int Key;
+		unsigned int Value;
+	};
+
+	GLStateCache();
+
+	unsigned int _program = Unknown;
+	unsigned int _vertexArray = Unknown;
+	unsigned int _activeUnit = Unknown;
+	// [unit][target slot], see TextureTargetSlot
+	unsigned int _textures[StateCacheTextureUnits][4];
+	std::vector<KeyValue> _buffers;
+	std::vector<BufferRange> _bufferRanges;
+	std::vector<KeyValue> _capabilities;
+	std::vector<KeyValue> _pixelStore;
+	unsigned int _blendSource = Unknown;
+	unsigned int _blendDestination = Unknown;
+	unsigned int _depthFunc = Unknown;
+	unsigned int _depthMask = Unknown;
+	unsigned int _cullFace = Unknown;
+	unsigned int _polygonMode = Unknown;
+	float _clearColor[4];
+	bool _clearColorKnown = false;
+	int _viewport[4];
+	bool _viewportKnown = false;
+	// Program -> location -> value bits
+	std::unordered_map<unsigned int, std::unordered_map<int, uint32_t>> _uniforms;
+
+	unsigned int _issued = 0;
+	unsigned int _filtered = 0;
+	unsigned int _lastIssued = 0;
+	unsigned int _lastFiltered = 0;
+
+	// True (and counted as issued) when the stored value differs, then it is updated
+	bool Changed(unsigned int& stored, unsigned int value);
+	bool Changed(std::vector<KeyValue>& table, unsigned int key, unsigned int value);
+	bool UniformChanged(int location, uint32_t bits);
+};
+
+#endif // !GL_STATE_CACHE_H
@@ -0,0 +1,166 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Surfaceless EGL context + offscreen framebuffer for running without a display
+/// -----------------
+// GLAD must be added before any other GL header
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <iostream>
+
+#include "HeadlessContext.h"
+
+HeadlessContext::~HeadlessContext()
+{
+	Destroy();
+}
+
+/// <summary>
+/// Creates the EGL display and context, makes it current, loads GLAD and builds the offscreen framebuffer
+/// </summary>
+/// <param name="width"> width of the offscreen framebuffer </param>
+/// <param name="height"> height of the offscreen framebuffer </param>
+/// <returns> true if the context is current and the framebuffer is complete </returns>
+bool HeadlessContext::Create(int width, int height)
+{
+	// Prefer the surfaceless platform so no X11/Wayland connection is ever attempted
+	EGLDisplay display = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+	{
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if (display == EGL_NO_DISPLAY)
+	{
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		std::cout << "ERROR::HEADLESS::EGL_INITIALIZE_FAILED" << std::endl;
+		return false;
+	}
+	_display = display;
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "ERROR::HEADLESS::OPENGL_API_NOT_SUPPORTED" << std::endl;
+		Destroy();
+		return false;
+	}
+
+	// Configless contexts skip the config search entirely, otherwise pick anything that can render desktop GL
+	EGLConfig config = (EGLConfig)0;
+	const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+	bool configless = extensions && (strstr(extensions, "EGL_KHR_no_config_context") || strstr(extensions, "EGL_MESA_configless_context"));
+	if (!configless)
+	{
+		const EGLint configAttribs[] =
+		{
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_NONE
+		};
+		EGLint numConfigs = 0;
+		if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0)
+		{
+			std::cout << "ERROR::HEADLESS::NO_MATCHING_CONFIG" << std::endl;
+			Destroy();
+			return false;
+		}
+	}
+
+	// Same version and profile the window path asks GLFW for
+	const EGLint contextAttribs[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+	if (context == EGL_NO_CONTEXT)
+	{
+		std::cout << "ERROR::HEADLESS::CONTEXT_CREATION_FAILED" << std::endl;
+		Destroy();
+		return false;
+	}
+	_context = context;
+
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		std::cout << "ERROR::HEADLESS::MAKE_CURRENT_FAILED" << std::endl;
+		Destroy();
+		return false;
+	}
+
+	if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::GetProcAddress))
+	{
+		std::cout << "ERROR::HEADLESS::GLAD_LOAD_FAILED" << std::endl;
+		Destroy();
+		return false;
+	}
+
+	// There is no default framebuffer without a surface, so render into our own
+	glGenRenderbuffers(1, &_colorRBO);
+	glBindRenderbuffer(GL_RENDERBUFFER, _colorRBO);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &_depthRBO);
+	glBindRenderbuffer(GL_RENDERBUFFER, _depthRBO);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorRBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthRBO);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+		Destroy();
+		return false;
+	}
+	glViewport(0, 0, width, height);
+
+	std::cout << "Headless context: " << glGetString(GL_RENDERER) << " | " << glGetString(GL_VERSION) << std::endl;
+	return true;
+}
+
+/// <summary>
+/// Releases the framebuffer, context and display. Safe to call more than once
+/// </summary>
+void HeadlessContext::Destroy()
+{
+	if (_context && FBO)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &FBO);
+		glDeleteRenderbuffers(1, &_colorRBO);
+		glDeleteRenderbuffers(1, &_depthRBO);
+	}
+	FBO = _colorRBO = _depthRBO = 0;
+
+	if (_display)
+	{
+		eglMakeCurrent((EGLDisplay)_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (_context)
+		{
+			eglDestroyContext((EGLDisplay)_display, (EGLContext)_context);
+		}
+		eglTerminate((EGLDisplay)_display);
+	}
+	_context = nullptr;
+	_display = nullptr;
+}
+
+/// <summary>
+/// Loader used by GLAD, EGL hands back core entry points as well as extensions
+/// </summary>
+/// <param name="name"> name of the GL function </param>
+void* HeadlessContext::GetProcAddress(const char* name)
+{
+	return (void*)eglGetProcAddress(name);
+}
@@ -0,0 +1,34 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Creates an OpenGL context without a window or display using surfaceless EGL (Mesa llvmpipe works fine).
+/// Rendering goes into an offscreen framebuffer so the render loop can run on machines with no display at all.
+/// -----------------
+
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+class HeadlessContext
+{
+public:
+
+	// Offscreen framebuffer that replaces the default (window) framebuffer
+	unsigned int FBO = 0;
+
+	HeadlessContext() = default;
+	~HeadlessContext();
+
+	bool Create(int width, int height);
+	void Destroy();
+
+	static void* GetProcAddress(const char* name);
+
+private:
+
+	void* _display = nullptr;
+	void* _context = nullptr;
+	unsigned int _colorRBO = 0;
+	unsigned int _depthRBO = 0;
+};
+
+#endif // !HEADLESS_CONTEXT_H
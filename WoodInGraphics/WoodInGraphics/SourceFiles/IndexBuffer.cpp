@@ -0,0 +1,112 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Index type selection and 16 bit submesh splitting
+/// -----------------
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "IndexBuffer.h"
+
+const uint32_t MaxShortRange = 65535;
+
+/// <summary>
+/// Copies indices narrowed to the given type, minus a base vertex
+/// </summary>
+template <typename T>
+static void WriteIndices(unsigned char* out, const uint32_t* indices, unsigned int count, uint32_t base)
+{
+	T* typed = (T*)out;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		typed[i] = (T)(indices[i] - base);
+	}
+}
+
+/// <summary>
+/// Plain 32 bit indices in one range, for meshes that can't be drawn with 16 bit ones
+/// </summary>
+static IndexBufferData BuildIntIndices(const uint32_t* indices, unsigned int indexCount)
+{
+	IndexBufferData data;
+	data.Type = GL_UNSIGNED_INT;
+	data.IndexSize = 4;
+	data.Bytes.resize(indexCount * sizeof(uint32_t));
+	memcpy(data.Bytes.data(), indices, data.Bytes.size());
+	data.Ranges.push_back({ 0, indexCount, 0 });
+	return data;
+}
+
+/// <summary>
+/// Builds the index data for a mesh in the smallest type that fits
+/// </summary>
+/// <param name="vertexCount"> vertices the indices point into, decides the type </param>
+/// <returns> the bytes to upload and the draws that cover them, one range unless the mesh had to be split </returns>
+IndexBufferData BuildIndexBuffer(const uint32_t* indices, unsigned int indexCount, unsigned int vertexCount, bool allowBytes)
+{
+	IndexBufferData data;
+	if (indexCount == 0)
+	{
+		return data;
+	}
+
+	if (allowBytes && vertexCount <= 256)
+	{
+		data.Type = GL_UNSIGNED_BYTE;
+		data.IndexSize = 1;
+		data.Bytes.resize(indexCount);
+		WriteIndices<uint8_t>(data.Bytes.data(), indices, indexCount, 0);
+		data.Ranges.push_back({ 0, indexCount, 0 });
+		return data;
+	}
+
+	data.Type = GL_UNSIGNED_SHORT;
+	data.IndexSize = 2;
+	data.Bytes.resize(indexCount * sizeof(uint16_t));
+	if (vertexCount <= MaxShortRange + 1)
+	{
+		WriteIndices<uint16_t>(data.Bytes.data(), indices, indexCount, 0);
+		data.Ranges.push_back({ 0, indexCount, 0 });
+		return data;
+	}
+
+	// Too many vertices for one 16 bit draw. Grow a range a triangle at a time while its lowest and highest vertex
+	// stay within 16 bits of each other, meshes are mostly ordered so neighbouring triangles share nearby vertices.
+	// A trailing partial triangle would never be drawn, so it is dropped
+	indexCount -= indexCount % 3;
+	data.Bytes.resize(indexCount * sizeof(uint16_t));
+	if (indexCount == 0)
+	{
+		return data;
+	}
+	unsigned int rangeStart = 0;
+	uint32_t low = UINT32_MAX;
+	uint32_t high = 0;
+	for (unsigned int triangle = 0; triangle < indexCount; triangle += 3)
+	{
+		uint32_t triangleLow = std::min(indices[triangle], std::min(indices[triangle + 1], indices[triangle + 2]));
+		uint32_t triangleHigh = std::max(indices[triangle], std::max(indices[triangle + 1], indices[triangle + 2]));
+		if (triangleHigh - triangleLow > MaxShortRange)
+		{
+			// No range can hold this triangle, its indices would wrap when narrowed. Rare enough (a triangle joining
+			// vertices 64K apart) that the whole mesh just stays 32 bit
+			return BuildIntIndices(indices, indexCount);
+		}
+		uint32_t newLow = std::min(low, triangleLow);
+		uint32_t newHigh = std::max(high, triangleHigh);
+		if (triangle > rangeStart && newHigh - newLow > MaxShortRange)
+		{
+			WriteIndices<uint16_t>(data.Bytes.data() + rangeStart * sizeof(uint16_t), indices + rangeStart, triangle - rangeStart, low);
+			data.Ranges.push_back({ rangeStart * sizeof(uint16_t), triangle - rangeStart, (int)low });
+			rangeStart = triangle;
+			newLow = triangleLow;
+			newHigh = triangleHigh;
+		}
+		low = newLow;
+		high = newHigh;
+	}
+	WriteIndices<uint16_t>(data.Bytes.data() + rangeStart * sizeof(uint16_t), indices + rangeStart, indexCount - rangeStart, low);
+	data.Ranges.push_back({ rangeStart * sizeof(uint16_t), indexCount - rangeStart, (int)low });
+	return data;
+}
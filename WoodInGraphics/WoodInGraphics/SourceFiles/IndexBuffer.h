@@ -0,0 +1,44 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Picks the smallest index type a mesh can use before it is uploaded. Meshes under 65536 vertices
+/// (nearly all of them) get 16 bit indices, half the memory and index fetch of 32 bit. Bigger meshes are cut into
+/// ranges of triangles whose vertices all sit within 65536 of each other, each range's indices are stored relative to
+/// its lowest vertex and drawn with that as the base vertex (glDrawElementsBaseVertex), so they stay 16 bit too.
+/// A mesh with a triangle whose own vertices are more than 65535 apart can't be split that way and stays 32 bit.
+/// 8 bit indices are opt in, they only save anything on tiny meshes and some GPUs widen them on the fly.
+/// -----------------
+
+#ifndef INDEX_BUFFER_H
+#define INDEX_BUFFER_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#pragma endregion Includes
+
+// One draw's worth of the index buffer
+struct IndexRange
+{
+	// Byte offset into the index buffer
+	size_t Offset = 0;
+	unsigned int Count = 0;
+	int BaseVertex = 0;
+};
+
+struct IndexBufferData
+{
+	// GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	unsigned int Type = 0x1403;
+	unsigned int IndexSize = 2;
+	std::vector<unsigned char> Bytes;
+	std::vector<IndexRange> Ranges;
+};
+
+// Indices are triangle lists. allowBytes lets meshes of 256 vertices or fewer use 8 bit indices
+IndexBufferData BuildIndexBuffer(const uint32_t* indices, unsigned int indexCount, unsigned int vertexCount, bool allowBytes = false);
+
+#endif // !INDEX_BUFFER_H
@@ -0,0 +1,20 @@
+#version 330 core
+
+out vec4 fragColor;
+
+in vec2 texCoord;
+in vec4 instanceTint;
+flat in float instanceLayer;
+in float instanceBlend;
+
+// One image per layer, each instance picks its own
+uniform sampler2DArray textureLayers;
+uniform sampler2D texture2;
+
+
+void main()
+{
+    vec4 base = texture(textureLayers, vec3(texCoord, instanceLayer));
+    vec4 overlay = texture(texture2, texCoord);
+    fragColor = mix(base, overlay, instanceBlend) * instanceTint;
+}
@@ -0,0 +1,158 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Per instance attribute streams and instanced drawing
+/// -----------------
+#include <glad/glad.h>
+
+#include "GLStateCache.h"
+#include "InstancedMesh.h"
+#include "Profiler.h"
+
+/// <summary>
+/// Sets the instance attribute pointers without touching their divisors or enables
+/// </summary>
+/// <param name="byteOffset"> where the first instance starts in the buffer </param>
+void SetInstanceAttributePointers(size_t byteOffset)
+{
+	// A mat4 attribute takes four locations, one per column
+	for (unsigned int column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(InstanceModelLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+			(void*)(byteOffset + offsetof(InstanceData, Model) + column * sizeof(glm::vec4)));
+	}
+	glVertexAttribPointer(InstanceTintLocation, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(byteOffset + offsetof(InstanceData, Tint)));
+	// Layer and Blend sit next to each other so they go in as one vec2
+	glVertexAttribPointer(InstanceLayerBlendLocation, 2, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(byteOffset + offsetof(InstanceData, Layer)));
+}
+
+InstancedMesh::~InstancedMesh()
+{
+	Release();
+}
+
+/// <summary>
+/// Uploads the geometry and sets up both attribute streams in one vertex array
+/// </summary>
+/// <param name="vertexStride"> bytes from one vertex to the next </param>
+/// <param name="attributes"> per vertex attributes, locations must stay below InstanceModelLocation </param>
+void InstancedMesh::Create(const void* vertices, size_t vertexBytes, size_t vertexStride, const VertexAttribute* attributes,
+	unsigned int attributeCount, const uint32_t* indices, unsigned int indexCount)
+{
+	GLStateCache& state = GLStateCache::Instance();
+	glGenVertexArrays(1, &_vertexArray);
+	glGenBuffers(1, &_vertexBuffer);
+	glGenBuffers(1, &_indexBuffer);
+	glGenBuffers(1, &_instanceBuffer);
+	IndexBufferData indexData = BuildIndexBuffer(indices, indexCount, (unsigned int)(vertexBytes / vertexStride));
+	_indexCount = indexCount;
+	_indexType = indexData.Type;
+	_indexRanges = indexData.Ranges;
+
+	state.BindVertexArray(_vertexArray);
+	state.BindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexBytes, vertices, GL_STATIC_DRAW);
+	state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexData.Bytes.size(), indexData.Bytes.data(), GL_STATIC_DRAW);
+	for (unsigned int i = 0; i < attributeCount; i++)
+	{
+		const VertexAttribute& attribute = attributes[i];
+		glVertexAttribPointer(attribute.Location, attribute.Components, attribute.Type, attribute.Normalized ? GL_TRUE : GL_FALSE,
+			(GLsizei)vertexStride, (void*)attribute.Offset);
+		glEnableVertexAttribArray(attribute.Location);
+	}
+
+	state.BindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+	SetInstanceAttributePointers(0);
+	for (unsigned int location = InstanceModelLocation; location <= InstanceLayerBlendLocation; location++)
+	{
+		glEnableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 1);
+	}
+
+	state.BindVertexArray(0);
+	state.BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstancedMesh::Release()
+{
+	GLStateCache& state = GLStateCache::Instance();
+	if (_vertexArray != 0)
+	{
+		state.DeleteVertexArray(_vertexArray);
+		_vertexArray = 0;
+	}
+	unsigned int* buffers[3] = { &_vertexBuffer, &_indexBuffer, &_instanceBuffer };
+	for (unsigned int* buffer : buffers)
+	{
+		if (*buffer != 0)
+		{
+			state.DeleteBuffer(*buffer);
+			*buffer = 0;
+		}
+	}
+	_instanceCount = 0;
+	_instanceCapacity = 0;
+	_indexRanges.clear();
+}
+
+/// <summary>
+/// Uploads the instances drawn by the next Draw
+/// </summary>
+void InstancedMesh::SetInstances(const InstanceData* instances, unsigned int count)
+{
+	_instanceCount = count;
+	if (count == 0)
+	{
+		return;
+	}
+	GLStateCache::Instance().BindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+	if (count > _instanceCapacity)
+	{
+		// Grow with headroom so a slowly growing count doesn't reallocate every frame
+		_instanceCapacity = count + count / 2;
+	}
+	// Orphan then fill, the driver hands out fresh memory if the last draw hasn't finished with the old
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(_instanceCapacity * sizeof(InstanceData)), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(count * sizeof(InstanceData)), instances);
+	Profiler::Instance().CountUploadBytes(count * sizeof(InstanceData));
+}
+
+void InstancedMesh::Draw() const
+{
+	if (_instanceCount == 0)
+	{
+		return;
+	}
+	GLStateCache::Instance().BindVertexArray(_vertexArray);
+	for (const IndexRange& range : _indexRanges)
+	{
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)range.Count, _indexType, (void*)range.Offset,
+			(GLsizei)_instanceCount, range.BaseVertex);
+	}
+	Profiler::Instance().CountDrawCalls((unsigned int)_indexRanges.size());
+}
+
+unsigned int InstancedMesh::GetVertexArray() const
+{
+	return _vertexArray;
+}
+
+unsigned int InstancedMesh::GetIndexCount() const
+{
+	return _indexCount;
+}
+
+unsigned int InstancedMesh::GetIndexType() const
+{
+	return _indexType;
+}
+
+const std::vector<IndexRange>& InstancedMesh::GetIndexRanges() const
+{
+	return _indexRanges;
+}
+
+unsigned int InstancedMesh::GetInstanceCount() const
+{
+	return _instanceCount;
+}
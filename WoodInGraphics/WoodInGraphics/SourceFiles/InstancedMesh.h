@@ -0,0 +1,97 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Geometry drawn many times with one glDrawElementsInstanced. The mesh's vertex attributes step per
+/// vertex as usual, a second buffer holds one InstanceData per copy and its attributes step per instance
+/// (glVertexAttribDivisor 1), so a thousand copies cost the same one draw call as a single one.
+/// Instance attribute locations, after the mesh's own:
+///   3-6 model matrix columns | 7 tint | 8 x texture layer, y blend weight
+/// See InstancedVertexShader.vert for a shader that reads them.
+/// -----------------
+
+#ifndef INSTANCED_MESH_H
+#define INSTANCED_MESH_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "IndexBuffer.h"
+
+#pragma endregion Includes
+
+const unsigned int InstanceModelLocation = 3;
+const unsigned int InstanceTintLocation = 7;
+const unsigned int InstanceLayerBlendLocation = 8;
+
+// One per vertex attribute of the mesh. Type is a GL enum (GL_FLOAT, GL_UNSIGNED_BYTE, ...)
+struct VertexAttribute
+{
+	unsigned int Location;
+	int Components;
+	unsigned int Type;
+	bool Normalized;
+	size_t Offset;
+};
+
+struct InstanceData
+{
+	glm::mat4 Model = glm::mat4(1.0f);
+	glm::vec4 Tint = glm::vec4(1.0f);
+	// Layer of the array texture the instanced shader samples (textureLayers in InstancedFragmentShader.frag)
+	float Layer = 0.0f;
+	// Same job as arrowAlpha, per instance
+	float Blend = 0.0f;
+	float Padding[2] = { 0.0f, 0.0f };
+};
+
+// Points locations 3-8 at InstanceData in the bound GL_ARRAY_BUFFER, starting byteOffset in. Affects the bound vertex array
+void SetInstanceAttributePointers(size_t byteOffset);
+
+class InstancedMesh
+{
+public:
+
+	InstancedMesh() = default;
+	~InstancedMesh();
+
+	InstancedMesh(const InstancedMesh&) = delete;
+	InstancedMesh& operator=(const InstancedMesh&) = delete;
+
+	// GL thread only. Indices come in 32 bit and are stored in the smallest type that fits, see IndexBuffer.h.
+	// The vertex data is copied into a static buffer
+	void Create(const void* vertices, size_t vertexBytes, size_t vertexStride, const VertexAttribute* attributes,
+		unsigned int attributeCount, const uint32_t* indices, unsigned int indexCount);
+	void Release();
+
+	// Replaces the instance data, the buffer grows as needed and is orphaned so a draw still in flight is untouched
+	void SetInstances(const InstanceData* instances, unsigned int count);
+	// Binds the vertex array and draws every instance, the program and textures are the caller's
+	void Draw() const;
+
+	unsigned int GetVertexArray() const;
+	unsigned int GetIndexCount() const;
+	unsigned int GetIndexType() const;
+	// One draw each, a single range unless the mesh was too big for 16 bit indices
+	const std::vector<IndexRange>& GetIndexRanges() const;
+	unsigned int GetInstanceCount() const;
+
+private:
+
+	unsigned int _vertexArray = 0;
+	unsigned int _vertexBuffer = 0;
+	unsigned int _indexBuffer = 0;
+	unsigned int _instanceBuffer = 0;
+	unsigned int _indexCount = 0;
+	unsigned int _indexType = 0;
+	std::vector<IndexRange> _indexRanges;
+	unsigned int _instanceCount = 0;
+	// Instances the instance buffer has room for
+	unsigned int _instanceCapacity = 0;
+};
+
+#endif // !INSTANCED_MESH_H
@@ -0,0 +1,25 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec2 aTexCoord;
+// Per instance, see InstancedMesh.h
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in vec4 aTint;
+layout (location = 8) in vec2 aLayerBlend;
+
+#include "UniformBlocks.glsl"
+
+out vec2 texCoord;
+out vec4 instanceTint;
+flat out float instanceLayer;
+out float instanceBlend;
+
+void main()
+{
+	gl_Position = viewProjection * aModel * vec4(aPos, 1.0f);
+	texCoord = aTexCoord;
+	instanceTint = aTint;
+	instanceLayer = aLayerBlend.x;
+	instanceBlend = aLayerBlend.y;
+}
\ No newline at end of file
@@ -0,0 +1,332 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Recursive descent JSON parser
+/// -----------------
+#include <cstdlib>
+#include <cstring>
+
+#include "Json.h"
+
+// Deeper nesting than this is treated as malformed rather than risking the stack
+const unsigned int JsonMaxDepth = 256;
+
+struct JsonParser
+{
+	const char* Position;
+	const char* End;
+
+	void SkipWhitespace()
+	{
+		while (Position < End && (*Position == ' ' || *Position == '\t' || *Position == '\n' || *Position == '\r'))
+		{
+			Position++;
+		}
+	}
+
+	bool Literal(const char* word)
+	{
+		size_t length = strlen(word);
+		if ((size_t)(End - Position) < length || memcmp(Position, word, length) != 0)
+		{
+			return false;
+		}
+		Position += length;
+		return true;
+	}
+
+	static void AppendUtf8(std::string& out, unsigned int codepoint)
+	{
+		if (codepoint < 0x80)
+		{
+			out += (char)codepoint;
+		}
+		else if (codepoint < 0x800)
+		{
+			out += (char)(0xC0 | (codepoint >> 6));
+			out += (char)(0x80 | (codepoint & 0x3F));
+		}
+		else if (codepoint < 0x10000)
+		{
+			out += (char)(0xE0 | (codepoint >> 12));
+			out += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+			out += (char)(0x80 | (codepoint & 0x3F));
+		}
+		else
+		{
+			out += (char)(0xF0 | (codepoint >> 18));
+			out += (char)(0x80 | ((codepoint >> 12) & 0x3F));
+			out += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+			out += (char)(0x80 | (codepoint & 0x3F));
+		}
+	}
+
+	bool Hex4(unsigned int& value)
+	{
+		if (End - Position < 4)
+		{
+			return false;
+		}
+		value = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			char c = *Position++;
+			value <<= 4;
+			if (c >= '0' && c <= '9')
+			{
+				value |= c - '0';
+			}
+			else if (c >= 'a' && c <= 'f')
+			{
+				value |= c - 'a' + 10;
+			}
+			else if (c >= 'A' && c <= 'F')
+			{
+				value |= c - 'A' + 10;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ParseString(std::string& out)
+	{
+		// Opening quote already checked
+		Position++;
+		while (Position < End)
+		{
+			char c = *Position++;
+			if (c == '"')
+			{
+				return true;
+			}
+			if (c != '\\')
+			{
+				out += c;
+				continue;
+			}
+			if (Position >= End)
+			{
+				return false;
+			}
+			char escape = *Position++;
+			switch (escape)
+			{
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':
+			{
+				unsigned int codepoint;
+				if (!Hex4(codepoint))
+				{
+					return false;
+				}
+				// Surrogate pair
+				if (codepoint >= 0xD800 && codepoint < 0xDC00 && Literal("\\u"))
+				{
+					unsigned int low;
+					if (!Hex4(low))
+					{
+						return false;
+					}
+					codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+				}
+				AppendUtf8(out, codepoint);
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+		return false;
+	}
+
+	bool ParseValue(JsonValue& value, unsigned int depth)
+	{
+		if (depth > JsonMaxDepth)
+		{
+			return false;
+		}
+		SkipWhitespace();
+		if (Position >= End)
+		{
+			return false;
+		}
+		switch (*Position)
+		{
+		case '{':
+		{
+			value.Type = JsonType::Object;
+			Position++;
+			SkipWhitespace();
+			if (Position < End && *Position == '}')
+			{
+				Position++;
+				return true;
+			}
+			while (true)
+			{
+				SkipWhitespace();
+				if (Position >= End || *Position != '"')
+				{
+					return false;
+				}
+				value.Object.emplace_back();
+				if (!ParseString(value.Object.back().first))
+				{
+					return false;
+				}
+				SkipWhitespace();
+				if (Position >= End || *Position++ != ':')
+				{
+					return false;
+				}
+				if (!ParseValue(value.Object.back().second, depth + 1))
+				{
+					return false;
+				}
+				SkipWhitespace();
+				if (Position >= End)
+				{
+					return false;
+				}
+				char next = *Position++;
+				if (next == '}')
+				{
+					return true;
+				}
+				if (next != ',')
+				{
+					return false;
+				}
+			}
+		}
+		case '[':
+		{
+			value.Type = JsonType::Array;
+			Position++;
+			SkipWhitespace();
+			if (Position < End && *Position == ']')
+			{
+				Position++;
+				return true;
+			}
+			while (true)
+			{
+				value.Array.emplace_back();
+				if (!ParseValue(value.Array.back(), depth + 1))
+				{
+					return false;
+				}
+				SkipWhitespace();
+				if (Position >= End)
+				{
+					return false;
+				}
+				char next = *Position++;
+				if (next == ']')
+				{
+					return true;
+				}
+				if (next != ',')
+				{
+					return false;
+				}
+			}
+		}
+		case '"':
+			value.Type = JsonType::String;
+			return ParseString(value.String);
+		case 't':
+			value.Type = JsonType::Bool;
+			value.Bool = true;
+			return Literal("true");
+		case 'f':
+			value.Type = JsonType::Bool;
+			return Literal("false");
+		case 'n':
+			return Literal("null");
+		default:
+		{
+			// strtod needs a terminated string, numbers are short so copy one out
+			char number[64];
+			size_t length = 0;
+			while (Position + length < End && length < sizeof(number) - 1 && strchr("+-0123456789.eE", Position[length]))
+			{
+				length++;
+			}
+			if (length == 0)
+			{
+				return false;
+			}
+			memcpy(number, Position, length);
+			number[length] = '\0';
+			char* parsedEnd;
+			value.Type = JsonType::Number;
+			value.Number = strtod(number, &parsedEnd);
+			Position += length;
+			return parsedEnd == number + length;
+		}
+		}
+	}
+};
+
+const JsonValue* JsonValue::Find(const char* key) const
+{
+	if (Type != JsonType::Object)
+	{
+		return nullptr;
+	}
+	for (const std::pair<std::string, JsonValue>& member : Object)
+	{
+		if (member.first == key)
+		{
+			return &member.second;
+		}
+	}
+	return nullptr;
+}
+
+const JsonValue* JsonValue::At(size_t index) const
+{
+	if (Type != JsonType::Array || index >= Array.size())
+	{
+		return nullptr;
+	}
+	return &Array[index];
+}
+
+double JsonValue::NumberOr(const char* key, double fallback) const
+{
+	const JsonValue* member = Find(key);
+	return member && member->Type == JsonType::Number ? member->Number : fallback;
+}
+
+int JsonValue::IntOr(const char* key, int fallback) const
+{
+	return (int)NumberOr(key, fallback);
+}
+
+/// <summary>
+/// Parses a whole JSON document
+/// </summary>
+/// <returns> false if the text is not valid JSON or has anything but whitespace after the value </returns>
+bool ParseJson(const char* text, size_t length, JsonValue& value)
+{
+	JsonParser parser = { text, text + length };
+	value = JsonValue();
+	if (!parser.ParseValue(value, 0))
+	{
+		return false;
+	}
+	parser.SkipWhitespace();
+	return parser.Position == parser.End;
+}
@@ -0,0 +1,55 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Just enough JSON to read glTF: a recursive descent parser into a small value tree. Numbers are
+/// doubles, \u escapes are decoded to UTF-8, objects keep their keys in file order and are searched linearly,
+/// which is fine for the handful of keys a glTF object has.
+/// -----------------
+
+#ifndef JSON_H
+#define JSON_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#pragma endregion Includes
+
+enum class JsonType
+{
+	Null,
+	Bool,
+	Number,
+	String,
+	Array,
+	Object
+};
+
+class JsonValue
+{
+public:
+
+	JsonType Type = JsonType::Null;
+	bool Bool = false;
+	double Number = 0.0;
+	std::string String;
+	std::vector<JsonValue> Array;
+	std::vector<std::pair<std::string, JsonValue>> Object;
+
+	// Member of an object, nullptr if missing or this is not an object
+	const JsonValue* Find(const char* key) const;
+	// Element of an array, nullptr if out of range or this is not an array
+	const JsonValue* At(size_t index) const;
+
+	// Member as a number, fallback if missing or not a number
+	double NumberOr(const char* key, double fallback) const;
+	int IntOr(const char* key, int fallback) const;
+};
+
+// False on malformed input, value is left partly filled
+bool ParseJson(const char* text, size_t length, JsonValue& value);
+
+#endif // !JSON_H
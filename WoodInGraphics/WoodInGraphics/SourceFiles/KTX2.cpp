@@ -0,0 +1,283 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: KTX2 writer and reader, see the Khronos KTX 2.0 spec for the layout
+/// -----------------
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include "KTX2.h"
+
+static const unsigned char KTX2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// Identifier, header and the fixed part of the index
+static const size_t KTX2HeaderBytes = 80;
+static const size_t KTX2LevelIndexEntryBytes = 24;
+// kvdByteOffset and kvdByteLength in the index
+static const size_t KTX2KeyValueIndexOffset = 56;
+
+// Khronos data format descriptor color models
+static const uint32_t ColorModelBC1A = 128;
+static const uint32_t ColorModelBC3 = 130;
+static const uint32_t ColorModelBC7 = 134;
+
+#pragma region Byte Helpers
+
+static void AppendU32(std::vector<unsigned char>& buffer, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		buffer.push_back((unsigned char)(value >> (i * 8)));
+	}
+}
+
+static void PatchU32(std::vector<unsigned char>& buffer, size_t offset, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		buffer[offset + i] = (unsigned char)(value >> (i * 8));
+	}
+}
+
+static void PatchU64(std::vector<unsigned char>& buffer, size_t offset, uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		buffer[offset + i] = (unsigned char)(value >> (i * 8));
+	}
+}
+
+static uint32_t ReadU32(const unsigned char* data)
+{
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static uint64_t ReadU64(const unsigned char* data)
+{
+	return (uint64_t)ReadU32(data) | ((uint64_t)ReadU32(data + 4) << 32);
+}
+
+static void PadTo(std::vector<unsigned char>& buffer, size_t alignment)
+{
+	while (buffer.size() % alignment != 0)
+	{
+		buffer.push_back(0);
+	}
+}
+
+#pragma endregion Byte Helpers
+
+unsigned int KTX2VkFormat(BlockFormat format, bool srgb)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return srgb ? VkFormatBC1RGBSRGB : VkFormatBC1RGBUnorm;
+	case BlockFormat::BC3: return srgb ? VkFormatBC3SRGB : VkFormatBC3Unorm;
+	case BlockFormat::BC7: return srgb ? VkFormatBC7SRGB : VkFormatBC7Unorm;
+	}
+	return 0;
+}
+
+bool KTX2IsSRGB(unsigned int vkFormat)
+{
+	return vkFormat == VkFormatBC1RGBSRGB || vkFormat == VkFormatBC3SRGB || vkFormat == VkFormatBC7SRGB;
+}
+
+/// <summary>
+/// Basic data format descriptor block for a 4x4 block compressed format
+/// </summary>
+static void AppendDataFormatDescriptor(std::vector<unsigned char>& buffer, BlockFormat format, bool srgb)
+{
+	// Sample: bit offset, bit length - 1, channel id (0 color, 15 alpha)
+	struct Sample { uint32_t BitOffset, BitLength, Channel; };
+	std::vector<Sample> samples;
+	uint32_t colorModel = ColorModelBC1A;
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		samples.push_back({ 0, 63, 0 });
+		break;
+	case BlockFormat::BC3:
+		colorModel = ColorModelBC3;
+		samples.push_back({ 0, 63, 15 });
+		samples.push_back({ 64, 63, 0 });
+		break;
+	case BlockFormat::BC7:
+		colorModel = ColorModelBC7;
+		samples.push_back({ 0, 127, 0 });
+		break;
+	}
+
+	uint32_t blockSize = 24 + 16 * (uint32_t)samples.size();
+	AppendU32(buffer, 4 + blockSize);					// dfdTotalSize
+	AppendU32(buffer, 0);								// vendor Khronos, descriptor type basic
+	AppendU32(buffer, 2 | (blockSize << 16));			// version 1.3, block size
+	uint32_t transfer = srgb ? 2 : 1;
+	AppendU32(buffer, colorModel | (1u << 8) | (transfer << 16));	// BT.709 primaries, straight alpha
+	AppendU32(buffer, 3 | (3 << 8));					// 4x4x1x1 texel block
+	AppendU32(buffer, (uint32_t)BlockBytes(format));	// bytes in plane 0
+	AppendU32(buffer, 0);
+	for (const Sample& sample : samples)
+	{
+		AppendU32(buffer, sample.BitOffset | (sample.BitLength << 16) | (sample.Channel << 24));
+		AppendU32(buffer, 0);
+		AppendU32(buffer, 0);
+		AppendU32(buffer, 0xFFFFFFFFu);
+	}
+}
+
+static void AppendKeyValue(std::vector<unsigned char>& buffer, const char* key, const char* value)
+{
+	uint32_t length = (uint32_t)(strlen(key) + 1 + strlen(value) + 1);
+	AppendU32(buffer, length);
+	buffer.insert(buffer.end(), key, key + strlen(key) + 1);
+	buffer.insert(buffer.end(), value, value + strlen(value) + 1);
+	PadTo(buffer, 4);
+}
+
+/// <summary>
+/// Writes a KTX2 file, the row order is recorded as orientation "ru" or "rd"
+/// </summary>
+/// <param name="bottomToTop"> rows are bottom to top (the GL convention, a flipped load) rather than as stored in the image </param>
+/// <param name="levels"> compressed data for each mip level, level 0 first </param>
+/// <returns> false if the file could not be written </returns>
+bool WriteKTX2(const std::string& path, BlockFormat format, bool srgb, bool bottomToTop, int width, int height,
+	const std::vector<std::vector<unsigned char>>& levels)
+{
+	std::vector<unsigned char> buffer(KTX2Identifier, KTX2Identifier + sizeof(KTX2Identifier));
+	AppendU32(buffer, KTX2VkFormat(format, srgb));
+	AppendU32(buffer, 1);								// typeSize, 1 for block compressed
+	AppendU32(buffer, (uint32_t)width);
+	AppendU32(buffer, (uint32_t)height);
+	AppendU32(buffer, 0);								// pixelDepth
+	AppendU32(buffer, 0);								// layerCount
+	AppendU32(buffer, 1);								// faceCount
+	AppendU32(buffer, (uint32_t)levels.size());
+	AppendU32(buffer, 0);								// no supercompression
+
+	// Index, filled in once the sections are laid out
+	size_t indexOffset = buffer.size();
+	buffer.resize(KTX2HeaderBytes + levels.size() * KTX2LevelIndexEntryBytes, 0);
+
+	size_t dfdOffset = buffer.size();
+	AppendDataFormatDescriptor(buffer, format, srgb);
+	size_t kvdOffset = buffer.size();
+	// Keys have to be sorted
+	AppendKeyValue(buffer, "KTXorientation", bottomToTop ? "ru" : "rd");
+	AppendKeyValue(buffer, "KTXwriter", "wig-texbake");
+	size_t kvdLength = buffer.size() - kvdOffset;
+
+	PatchU32(buffer, indexOffset, (uint32_t)dfdOffset);
+	PatchU32(buffer, indexOffset + 4, (uint32_t)(kvdOffset - dfdOffset));
+	PatchU32(buffer, indexOffset + 8, (uint32_t)kvdOffset);
+	PatchU32(buffer, indexOffset + 12, (uint32_t)kvdLength);
+
+	// Smallest level first so a streaming reader gets something to show early
+	size_t alignment = std::max<size_t>(BlockBytes(format), 4);
+	for (size_t level = levels.size(); level-- > 0;)
+	{
+		PadTo(buffer, alignment);
+		size_t entry = KTX2HeaderBytes + level * KTX2LevelIndexEntryBytes;
+		PatchU64(buffer, entry, buffer.size());
+		PatchU64(buffer, entry + 8, levels[level].size());
+		PatchU64(buffer, entry + 16, levels[level].size());
+		buffer.insert(buffer.end(), levels[level].begin(), levels[level].end());
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+	file.write((const char*)buffer.data(), (std::streamsize)buffer.size());
+	return (bool)file;
+}
+
+/// <summary>
+/// Reads the header and level index of a KTX2 file that is already in memory, nothing is copied
+/// </summary>
+/// <returns> false if the data is not a KTX2 file this loader can handle </returns>
+bool ParseKTX2(const unsigned char* data, size_t size, KTX2Info& info)
+{
+	if (size < KTX2HeaderBytes || memcmp(data, KTX2Identifier, sizeof(KTX2Identifier)) != 0)
+	{
+		return false;
+	}
+
+	const unsigned char* header = data + sizeof(KTX2Identifier);
+	info.VkFormat = ReadU32(header);
+	info.Width = (int)ReadU32(header + 8);
+	info.Height = (int)ReadU32(header + 12);
+	uint32_t depth = ReadU32(header + 16);
+	uint32_t layers = ReadU32(header + 20);
+	uint32_t faces = ReadU32(header + 24);
+	uint32_t levelCount = std::max<uint32_t>(ReadU32(header + 28), 1);
+	uint32_t supercompression = ReadU32(header + 32);
+	if (depth > 1 || layers > 1 || faces != 1 || supercompression != 0 || info.Width <= 0 || info.Height <= 0)
+	{
+		return false;
+	}
+	// A full chain is floor(log2(largest side)) + 1 levels, more would shift the size by 32 or more below
+	uint32_t maxLevels = 1;
+	for (int extent = std::max(info.Width, info.Height); extent > 1; extent >>= 1)
+	{
+		maxLevels++;
+	}
+	if (levelCount > maxLevels)
+	{
+		return false;
+	}
+	if (KTX2HeaderBytes + (size_t)levelCount * KTX2LevelIndexEntryBytes > size)
+	{
+		return false;
+	}
+
+	// Key/value data, only the orientation is used. The second letter is the y direction, "u" is bottom to top
+	uint32_t kvdOffset = ReadU32(data + KTX2KeyValueIndexOffset);
+	uint32_t kvdLength = ReadU32(data + KTX2KeyValueIndexOffset + 4);
+	if (kvdOffset > size || kvdLength > size - kvdOffset)
+	{
+		return false;
+	}
+	info.BottomToTop = false;
+	size_t pair = kvdOffset;
+	size_t kvdEnd = (size_t)kvdOffset + kvdLength;
+	while (pair + 4 <= kvdEnd)
+	{
+		uint32_t length = ReadU32(data + pair);
+		const char* key = (const char*)data + pair + 4;
+		if (length > kvdEnd - pair - 4)
+		{
+			return false;
+		}
+		size_t keyLength = strnlen(key, length);
+		if (keyLength < length && strcmp(key, "KTXorientation") == 0)
+		{
+			const char* value = key + keyLength + 1;
+			size_t valueLength = length - keyLength - 1;
+			info.BottomToTop = valueLength >= 2 && value[1] == 'u';
+		}
+		pair += 4 + ((length + 3) & ~(size_t)3);
+	}
+
+	info.Levels.clear();
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		const unsigned char* entry = data + KTX2HeaderBytes + (size_t)level * KTX2LevelIndexEntryBytes;
+		uint64_t offset = ReadU64(entry);
+		uint64_t length = ReadU64(entry + 8);
+		if (offset > size || length > size - offset)
+		{
+			return false;
+		}
+
+		KTX2Level mip;
+		mip.Offset = (size_t)offset;
+		mip.Size = (size_t)length;
+		mip.Width = std::max(1, info.Width >> level);
+		mip.Height = std::max(1, info.Height >> level);
+		info.Levels.push_back(mip);
+	}
+	return true;
+}
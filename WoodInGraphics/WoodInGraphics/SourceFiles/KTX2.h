@@ -0,0 +1,57 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Minimal KTX2 container support for block compressed 2D textures with a full mip chain.
+/// Only what the texture baker writes is handled: one face, one layer, no supercompression.
+/// -----------------
+
+#ifndef KTX2_H
+#define KTX2_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "BlockCompression.h"
+
+#pragma endregion Includes
+
+// Vulkan format numbers used by KTX2
+const unsigned int VkFormatBC1RGBUnorm = 131;
+const unsigned int VkFormatBC1RGBSRGB = 132;
+const unsigned int VkFormatBC3Unorm = 137;
+const unsigned int VkFormatBC3SRGB = 138;
+const unsigned int VkFormatBC7Unorm = 145;
+const unsigned int VkFormatBC7SRGB = 146;
+
+// One mip level, Offset is relative to the start of the file
+struct KTX2Level
+{
+	size_t Offset = 0;
+	size_t Size = 0;
+	int Width = 0;
+	int Height = 0;
+};
+
+struct KTX2Info
+{
+	unsigned int VkFormat = 0;
+	int Width = 0;
+	int Height = 0;
+	// From KTXorientation, rows top to bottom ("rd") when the file doesn't say
+	bool BottomToTop = false;
+	// Level 0 (full size) first
+	std::vector<KTX2Level> Levels;
+};
+
+unsigned int KTX2VkFormat(BlockFormat format, bool srgb);
+bool KTX2IsSRGB(unsigned int vkFormat);
+
+bool WriteKTX2(const std::string& path, BlockFormat format, bool srgb, bool bottomToTop, int width, int height,
+	const std::vector<std::vector<unsigned char>>& levels);
+
+bool ParseKTX2(const unsigned char* data, size_t size, KTX2Info& info);
+
+#endif // !KTX2_H
@@ -0,0 +1,81 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Chunked bump allocator
+/// -----------------
+#include <algorithm>
+
+#include "LinearArena.h"
+
+/// <param name="chunkBytes"> size of each block taken from the heap </param>
+LinearArena::LinearArena(size_t chunkBytes)
+	: _chunkBytes(chunkBytes)
+{
+}
+
+/// <summary>
+/// Bumps the current chunk, moving on to the next (reused or new) chunk when it is full
+/// </summary>
+/// <param name="bytes"> size of the allocation </param>
+/// <param name="alignment"> power of two </param>
+void* LinearArena::Allocate(size_t bytes, size_t alignment)
+{
+	while (_current < _chunks.size())
+	{
+		Chunk& chunk = _chunks[_current];
+		// Chunk memory comes from new[] so it is max_align_t aligned, aligning the offset is enough
+		size_t offset = (chunk.Used + alignment - 1) & ~(alignment - 1);
+		if (offset + bytes <= chunk.Capacity)
+		{
+			_bytesUsed += offset + bytes - chunk.Used;
+			chunk.Used = offset + bytes;
+			return chunk.Memory.get() + offset;
+		}
+		_current++;
+		if (_current < _chunks.size())
+		{
+			_chunks[_current].Used = 0;
+		}
+	}
+
+	Chunk chunk;
+	chunk.Capacity = std::max(_chunkBytes, bytes);
+	chunk.Memory.reset(new unsigned char[chunk.Capacity]);
+	chunk.Used = bytes;
+	_bytesUsed += bytes;
+	_chunks.push_back(std::move(chunk));
+	_current = _chunks.size() - 1;
+	return _chunks.back().Memory.get();
+}
+
+/// <summary>
+/// Forgets every allocation, the chunks are kept for the next round
+/// </summary>
+void LinearArena::Reset()
+{
+	if (!_chunks.empty())
+	{
+		_chunks[0].Used = 0;
+	}
+	_current = 0;
+	_bytesUsed = 0;
+}
+
+size_t LinearArena::BytesUsed() const
+{
+	return _bytesUsed;
+}
+
+size_t LinearArena::ChunkCount() const
+{
+	return _chunks.empty() ? 0 : std::min(_current + 1, _chunks.size());
+}
+
+const unsigned char* LinearArena::ChunkData(size_t chunk) const
+{
+	return _chunks[chunk].Memory.get();
+}
+
+size_t LinearArena::ChunkUsed(size_t chunk) const
+{
+	return _chunks[chunk].Used;
+}
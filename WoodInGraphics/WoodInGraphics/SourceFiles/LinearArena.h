@@ -0,0 +1,59 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Bump allocator for memory that all dies at the same time (a frame's commands). Allocating is a
+/// pointer bump, Reset rewinds without freeing so after the first few frames nothing touches the heap.
+/// Not thread safe, give each thread its own.
+/// -----------------
+
+#ifndef LINEAR_ARENA_H
+#define LINEAR_ARENA_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#pragma endregion Includes
+
+const size_t DefaultArenaChunkBytes = 64 * 1024;
+
+class LinearArena
+{
+public:
+
+	explicit LinearArena(size_t chunkBytes = DefaultArenaChunkBytes);
+
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	// Never returns null, a request bigger than a chunk gets a chunk of its own
+	void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+	void Reset();
+
+	// Bytes handed out since the last Reset
+	size_t BytesUsed() const;
+
+	// Used for walking what was written in allocation order, allocations never span chunks
+	size_t ChunkCount() const;
+	const unsigned char* ChunkData(size_t chunk) const;
+	size_t ChunkUsed(size_t chunk) const;
+
+private:
+
+	struct Chunk
+	{
+		std::unique_ptr<unsigned char[]> Memory;
+		size_t Capacity;
+		size_t Used;
+	};
+
+	size_t _chunkBytes;
+	std::vector<Chunk> _chunks;
+	// Chunk being allocated from, chunks past it are free for reuse
+	size_t _current = 0;
+	size_t _bytesUsed = 0;
+};
+
+#endif // !LINEAR_ARENA_H
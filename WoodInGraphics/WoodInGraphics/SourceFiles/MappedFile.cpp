@@ -0,0 +1,114 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Memory mapped file, mmap on Linux and a file mapping object on Windows
+/// -----------------
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#include "MappedFile.h"
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+/// <summary>
+/// Maps the whole file read only
+/// </summary>
+/// <param name="path"> file to map </param>
+/// <returns> false if the file is missing, empty or could not be mapped </returns>
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (!data)
+	{
+		if (mapping)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+	_file = file;
+	_mapping = mapping;
+	_data = (const unsigned char*)data;
+	_size = (size_t)size.QuadPart;
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size <= 0)
+	{
+		close(file);
+		return false;
+	}
+	void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	// The mapping keeps its own reference to the file
+	close(file);
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+	// Everything gets read front to back right away, start the read ahead now
+	madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+	madvise(data, (size_t)info.st_size, MADV_WILLNEED);
+	_data = (const unsigned char*)data;
+	_size = (size_t)info.st_size;
+#endif // _WIN32
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (!_data)
+	{
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(_data);
+	CloseHandle((HANDLE)_mapping);
+	CloseHandle((HANDLE)_file);
+	_mapping = nullptr;
+	_file = nullptr;
+#else
+	munmap((void*)_data, _size);
+#endif // _WIN32
+	_data = nullptr;
+	_size = 0;
+}
+
+const unsigned char* MappedFile::Data() const
+{
+	return _data;
+}
+
+size_t MappedFile::Size() const
+{
+	return _size;
+}
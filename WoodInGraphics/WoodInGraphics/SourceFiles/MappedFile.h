@@ -0,0 +1,44 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Read only memory mapped file. Pages come straight from the OS file cache, so reading a baked
+/// texture this way never makes a heap copy of it.
+/// -----------------
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <string>
+
+#pragma endregion Includes
+
+class MappedFile
+{
+public:
+
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	const unsigned char* Data() const;
+	size_t Size() const;
+
+private:
+
+	const unsigned char* _data = nullptr;
+	size_t _size = 0;
+#ifdef _WIN32
+	void* _file = nullptr;
+	void* _mapping = nullptr;
+#endif // _WIN32
+};
+
+#endif // !MAPPED_FILE_H
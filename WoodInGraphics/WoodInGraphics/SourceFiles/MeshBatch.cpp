@@ -0,0 +1,327 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Shared geometry buffers drawn with multi draw indirect
+/// -----------------
+#include <glad/glad.h>
+
+#include <cstring>
+#include <iostream>
+
+#include "GLStateCache.h"
+#include "IndexBuffer.h"
+#include "MeshBatch.h"
+#include "Profiler.h"
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand must match the GL layout");
+
+MeshBatch::~MeshBatch()
+{
+	Release();
+}
+
+/// <summary>
+/// Creates the shared buffers and a vertex array reading the mesh layout plus the per instance stream
+/// </summary>
+/// <param name="vertexStride"> bytes from one vertex to the next </param>
+/// <param name="attributes"> per vertex attributes, locations must stay below InstanceModelLocation </param>
+void MeshBatch::Create(size_t vertexStride, const VertexAttribute* attributes, unsigned int attributeCount)
+{
+	GLStateCache& state = GLStateCache::Instance();
+	glGenVertexArrays(1, &_vertexArray);
+	glGenBuffers(1, &_vertexBuffer);
+	glGenBuffers(1, &_indexBuffer);
+	glGenBuffers(1, &_instanceBuffer);
+	_vertexStride = vertexStride;
+	_multiDrawIndirect = GLAD_GL_ARB_multi_draw_indirect != 0;
+	if (_multiDrawIndirect)
+	{
+		glGenBuffers(1, &_indirectBuffer);
+	}
+
+	state.BindVertexArray(_vertexArray);
+	state.BindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+	state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+	for (unsigned int i = 0; i < attributeCount; i++)
+	{
+		const VertexAttribute& attribute = attributes[i];
+		glVertexAttribPointer(attribute.Location, attribute.Components, attribute.Type, attribute.Normalized ? GL_TRUE : GL_FALSE,
+			(GLsizei)vertexStride, (void*)attribute.Offset);
+		glEnableVertexAttribArray(attribute.Location);
+	}
+
+	state.BindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+	SetInstanceAttributePointers(0);
+	for (unsigned int location = InstanceModelLocation; location <= InstanceLayerBlendLocation; location++)
+	{
+		glEnableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 1);
+	}
+
+	state.BindVertexArray(0);
+	state.BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MeshBatch::Release()
+{
+	GLStateCache& state = GLStateCache::Instance();
+	if (_vertexArray != 0)
+	{
+		state.DeleteVertexArray(_vertexArray);
+		_vertexArray = 0;
+	}
+	unsigned int* buffers[4] = { &_vertexBuffer, &_indexBuffer, &_instanceBuffer, &_indirectBuffer };
+	for (unsigned int* buffer : buffers)
+	{
+		if (*buffer != 0)
+		{
+			state.DeleteBuffer(*buffer);
+			*buffer = 0;
+		}
+	}
+	_instanceCapacity = 0;
+	_indirectCapacity = 0;
+	_vertexData.clear();
+	_indexData.clear();
+	_parts.clear();
+	_materials.clear();
+	_pending.clear();
+	_instances.clear();
+}
+
+/// <summary>
+/// Appends a mesh to the shared buffers, its indices stay relative to its own first vertex
+/// </summary>
+/// <returns> where the mesh landed, pass it to Draw </returns>
+BatchMesh MeshBatch::AddMesh(const void* vertices, unsigned int vertexCount, const uint32_t* indices, unsigned int indexCount)
+{
+	uint32_t firstIndex = (uint32_t)_indexData.size();
+	int32_t baseVertex = (int32_t)(_vertexData.size() / _vertexStride);
+	IndexBufferData indexData = BuildIndexBuffer(indices, indexCount, vertexCount);
+	BatchMesh mesh;
+	if (indexData.Type != GL_UNSIGNED_SHORT)
+	{
+		// The batch shares one 16 bit index buffer, a mesh that had to stay 32 bit can't go in it
+		std::cout << "ERROR::MESH_BATCH::MESH_NEEDS_32_BIT_INDICES" << std::endl;
+		return mesh;
+	}
+	mesh.FirstPart = (uint32_t)_parts.size();
+	mesh.PartCount = (uint32_t)indexData.Ranges.size();
+	for (const IndexRange& range : indexData.Ranges)
+	{
+		_parts.push_back({ firstIndex + (uint32_t)(range.Offset / sizeof(uint16_t)), range.Count, baseVertex + range.BaseVertex });
+	}
+
+	size_t bytes = vertexCount * _vertexStride;
+	size_t start = _vertexData.size();
+	_vertexData.resize(start + bytes);
+	memcpy(_vertexData.data() + start, vertices, bytes);
+	const uint16_t* shortIndices = (const uint16_t*)indexData.Bytes.data();
+	_indexData.insert(_indexData.end(), shortIndices, shortIndices + indexData.Bytes.size() / sizeof(uint16_t));
+	return mesh;
+}
+
+/// <summary>
+/// Copies every mesh added so far into the GPU buffers
+/// </summary>
+void MeshBatch::Upload()
+{
+	GLStateCache& state = GLStateCache::Instance();
+	state.BindVertexArray(_vertexArray);
+	state.BindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)_vertexData.size(), _vertexData.data(), GL_STATIC_DRAW);
+	state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(_indexData.size() * sizeof(uint16_t)), _indexData.data(), GL_STATIC_DRAW);
+	Profiler::Instance().CountUploadBytes(_vertexData.size() + _indexData.size() * sizeof(uint16_t));
+	state.BindVertexArray(0);
+	state.BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/// <returns> the id Draw takes for this material </returns>
+unsigned int MeshBatch::AddMaterial(const BatchMaterial& material)
+{
+	_materials.push_back(material);
+	return (unsigned int)(_materials.size() - 1);
+}
+
+void MeshBatch::SetMaterial(unsigned int id, const BatchMaterial& material)
+{
+	if (id < _materials.size())
+	{
+		_materials[id] = material;
+	}
+}
+
+unsigned int MeshBatch::GetMaterialCount() const
+{
+	return (unsigned int)_materials.size();
+}
+
+/// <summary>
+/// Queues instances of a mesh for the next Flush
+/// </summary>
+/// <param name="material"> id from AddMaterial </param>
+/// <param name="instances"> count instances, copied </param>
+void MeshBatch::Draw(const BatchMesh& mesh, unsigned int material, const InstanceData* instances, unsigned int count)
+{
+	if (count == 0 || material >= _materials.size())
+	{
+		return;
+	}
+	for (uint32_t part = mesh.FirstPart; part < mesh.FirstPart + mesh.PartCount; part++)
+	{
+		PendingDraw draw;
+		draw.Material = material;
+		draw.Command.Count = _parts[part].IndexCount;
+		draw.Command.InstanceCount = count;
+		draw.Command.FirstIndex = _parts[part].FirstIndex;
+		draw.Command.BaseVertex = _parts[part].BaseVertex;
+		// The command finds its instances through the base instance, so they go in draw order. Every part of a split
+		// mesh shares them
+		draw.Command.BaseInstance = (uint32_t)_instances.size();
+		_pending.push_back(draw);
+	}
+	_instances.insert(_instances.end(), instances, instances + count);
+}
+
+/// <summary>
+/// Uploads this frame's instances and commands, then draws each material's commands
+/// </summary>
+void MeshBatch::Flush()
+{
+	ProfileZone zone("Mesh batch");
+	_lastDrawCalls = 0;
+	if (_pending.empty() || _vertexArray == 0)
+	{
+		_pending.clear();
+		_instances.clear();
+		return;
+	}
+
+	// Counting sort by material, keeps submission order within a material
+	unsigned int materialCount = (unsigned int)_materials.size();
+	_materialStarts.assign(materialCount + 1, 0);
+	for (const PendingDraw& draw : _pending)
+	{
+		_materialStarts[draw.Material + 1]++;
+	}
+	for (unsigned int i = 0; i < materialCount; i++)
+	{
+		_materialStarts[i + 1] += _materialStarts[i];
+	}
+	_commands.resize(_pending.size());
+	_materialCursors.assign(_materialStarts.begin(), _materialStarts.end() - 1);
+	for (const PendingDraw& draw : _pending)
+	{
+		_commands[_materialCursors[draw.Material]++] = draw.Command;
+	}
+
+	GLStateCache& state = GLStateCache::Instance();
+	Profiler& profiler = Profiler::Instance();
+	state.BindVertexArray(_vertexArray);
+	state.SetCapability(GL_BLEND, false);
+
+	// Orphan then fill, same as InstancedMesh
+	state.BindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+	if (_instances.size() > _instanceCapacity)
+	{
+		_instanceCapacity = _instances.size() + _instances.size() / 2;
+	}
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(_instanceCapacity * sizeof(InstanceData)), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(_instances.size() * sizeof(InstanceData)), _instances.data());
+	profiler.CountUploadBytes(_instances.size() * sizeof(InstanceData));
+
+	if (_multiDrawIndirect)
+	{
+		state.BindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectBuffer);
+		if (_commands.size() > _indirectCapacity)
+		{
+			_indirectCapacity = _commands.size() + _commands.size() / 2;
+		}
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)(_indirectCapacity * sizeof(DrawElementsIndirectCommand)), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, (GLsizeiptr)(_commands.size() * sizeof(DrawElementsIndirectCommand)), _commands.data());
+		profiler.CountUploadBytes(_commands.size() * sizeof(DrawElementsIndirectCommand));
+	}
+
+	for (unsigned int material = 0; material < materialCount; material++)
+	{
+		uint32_t first = _materialStarts[material];
+		uint32_t count = _materialStarts[material + 1] - first;
+		if (count == 0)
+		{
+			continue;
+		}
+		BindMaterial(_materials[material]);
+
+		if (_multiDrawIndirect)
+		{
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (void*)(first * sizeof(DrawElementsIndirectCommand)), (GLsizei)count, 0);
+			_lastDrawCalls++;
+			continue;
+		}
+
+		// 3.3 path, the same commands one draw at a time
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			const DrawElementsIndirectCommand& command = _commands[i];
+			void* indexOffset = (void*)(command.FirstIndex * sizeof(uint16_t));
+			if (GLAD_GL_ARB_base_instance)
+			{
+				glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, (GLsizei)command.Count, GL_UNSIGNED_SHORT, indexOffset,
+					(GLsizei)command.InstanceCount, command.BaseVertex, command.BaseInstance);
+			}
+			else
+			{
+				// No base instance in core 3.3, move the instance attributes to this command's first instance instead
+				SetInstanceAttributePointers(command.BaseInstance * sizeof(InstanceData));
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)command.Count, GL_UNSIGNED_SHORT, indexOffset,
+					(GLsizei)command.InstanceCount, command.BaseVertex);
+			}
+			_lastDrawCalls++;
+		}
+	}
+	if (!_multiDrawIndirect && !GLAD_GL_ARB_base_instance)
+	{
+		SetInstanceAttributePointers(0);
+	}
+
+	profiler.CountDrawCalls(_lastDrawCalls);
+	_pending.clear();
+	_instances.clear();
+}
+
+/// <summary>
+/// Forces the per command loop when false, turning it back on only works if the context has multi draw indirect
+/// </summary>
+void MeshBatch::SetMultiDrawIndirect(bool enabled)
+{
+	if (enabled && !GLAD_GL_ARB_multi_draw_indirect)
+	{
+		std::cout << "ERROR::MESH_BATCH::MULTI_DRAW_INDIRECT_NOT_SUPPORTED" << std::endl;
+		enabled = false;
+	}
+	if (enabled && _indirectBuffer == 0 && _vertexArray != 0)
+	{
+		glGenBuffers(1, &_indirectBuffer);
+	}
+	_multiDrawIndirect = enabled;
+}
+
+bool MeshBatch::UsesMultiDrawIndirect() const
+{
+	return _multiDrawIndirect;
+}
+
+unsigned int MeshBatch::LastDrawCalls() const
+{
+	return _lastDrawCalls;
+}
+
+void MeshBatch::BindMaterial(const BatchMaterial& material) const
+{
+	GLStateCache& state = GLStateCache::Instance();
+	state.UseProgram(material.Program);
+	for (unsigned int unit = 0; unit < material.TextureCount; unit++)
+	{
+		state.BindTexture(unit, material.TextureTargets[unit], material.Textures[unit]);
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Static meshes packed into one shared vertex and index buffer so they can all be drawn without
+/// switching vertex arrays. Each frame's draws become DrawElementsIndirectCommands, grouped by material, and each
+/// material is drawn with a single glMultiDrawElementsIndirect (GL 4.3 / GL_ARB_multi_draw_indirect).
+/// Per draw data lives in an InstanceData stream indexed by the command's base instance, same layout as InstancedMesh.
+/// On a 3.3 context the same commands are walked in a loop, one instanced draw each.
+/// Indices are 16 bit, a mesh too big for that is split into parts (see IndexBuffer.h) and each part is a command.
+/// -----------------
+
+#ifndef MESH_BATCH_H
+#define MESH_BATCH_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "InstancedMesh.h"
+#include "RenderQueue.h"
+
+#pragma endregion Includes
+
+// Layout glMultiDrawElementsIndirect reads, do not reorder
+struct DrawElementsIndirectCommand
+{
+	uint32_t Count;
+	uint32_t InstanceCount;
+	uint32_t FirstIndex;
+	int32_t BaseVertex;
+	uint32_t BaseInstance;
+};
+
+// Where a mesh sits in the shared buffers, as a run of parts
+struct BatchMesh
+{
+	uint32_t FirstPart = 0;
+	uint32_t PartCount = 0;
+};
+
+struct BatchMaterial
+{
+	unsigned int Program = 0;
+	unsigned int Textures[RenderQueueMaxTextures] = {};
+	// GL_TEXTURE_2D unless set, same as DrawPacket
+	unsigned int TextureTargets[RenderQueueMaxTextures] = { 0x0DE1, 0x0DE1, 0x0DE1, 0x0DE1 };
+	unsigned int TextureCount = 0;
+};
+
+class MeshBatch
+{
+public:
+
+	MeshBatch() = default;
+	~MeshBatch();
+
+	MeshBatch(const MeshBatch&) = delete;
+	MeshBatch& operator=(const MeshBatch&) = delete;
+
+	// GL thread only. Every mesh added shares this vertex layout
+	void Create(size_t vertexStride, const VertexAttribute* attributes, unsigned int attributeCount);
+	void Release();
+
+	// Indices come in 32 bit and are stored as 16. Meshes are kept on the CPU too, adding one after Upload needs another Upload
+	// A mesh that can't be narrowed to 16 bit (see IndexBuffer.h) is refused with an empty BatchMesh
+	BatchMesh AddMesh(const void* vertices, unsigned int vertexCount, const uint32_t* indices, unsigned int indexCount);
+	void Upload();
+	unsigned int AddMaterial(const BatchMaterial& material);
+	// Replaces a material's program and textures, e.g. once a streamed texture is ready
+	void SetMaterial(unsigned int id, const BatchMaterial& material);
+	unsigned int GetMaterialCount() const;
+
+	// Queues count instances of the mesh, Flush draws everything queued
+	void Draw(const BatchMesh& mesh, unsigned int material, const InstanceData* instances, unsigned int count = 1);
+	void Flush();
+
+	// Off forces the 3.3 loop even when multi draw indirect is there, for comparing the two
+	void SetMultiDrawIndirect(bool enabled);
+	bool UsesMultiDrawIndirect() const;
+	// Draw calls issued by the last Flush
+	unsigned int LastDrawCalls() const;
+
+private:
+
+	struct MeshPart
+	{
+		uint32_t FirstIndex;
+		uint32_t IndexCount;
+		int32_t BaseVertex;
+	};
+
+	struct PendingDraw
+	{
+		unsigned int Material;
+		DrawElementsIndirectCommand Command;
+	};
+
+	unsigned int _vertexArray = 0;
+	unsigned int _vertexBuffer = 0;
+	unsigned int _indexBuffer = 0;
+	unsigned int _instanceBuffer = 0;
+	unsigned int _indirectBuffer = 0;
+	size_t _vertexStride = 0;
+	size_t _instanceCapacity = 0;
+	size_t _indirectCapacity = 0;
+	bool _multiDrawIndirect = false;
+
+	std::vector<unsigned char> _vertexData;
+	std::vector<uint16_t> _indexData;
+	std::vector<MeshPart> _parts;
+	std::vector<BatchMaterial> _materials;
+
+	// This frame's draws, and the commands sorted into one run per material
+	std::vector<PendingDraw> _pending;
+	std::vector<InstanceData> _instances;
+	std::vector<DrawElementsIndirectCommand> _commands;
+	std::vector<uint32_t> _materialStarts;
+	// Where the sort writes each material's next command, kept so Flush doesn't allocate
+	std::vector<uint32_t> _materialCursors;
+	unsigned int _lastDrawCalls = 0;
+
+	void BindMaterial(const BatchMaterial& material) const;
+};
+
+#endif // !MESH_BATCH_H
@@ -0,0 +1,437 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Parallel OBJ parsing
+/// -----------------
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "MappedFile.h"
+#include "MeshImporter.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+// Chunks smaller than this are not worth a job
+const size_t OBJMinChunkBytes = 256 * 1024;
+// Jobs per pool thread, more than one evens out chunks that parse slower than others
+const unsigned int OBJChunksPerThread = 4;
+
+static const double Pow10[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/// <summary>
+/// Parses [+-]digits[.digits][(e|E)[+-]digits] after any spaces or tabs. Up to 19 significant digits are gathered
+/// into an integer and scaled by an exact power of ten, which is exact to float precision for anything an exporter
+/// writes. Far larger or smaller exponents fall back to pow
+/// </summary>
+const char* ParseFastFloat(const char* text, const char* end, float& value)
+{
+	const char* p = text;
+	while (p < end && (*p == ' ' || *p == '\t'))
+	{
+		p++;
+	}
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		p++;
+	}
+
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int digits = 0;
+	bool anyDigits = false;
+	while (p < end && (unsigned int)(*p - '0') < 10)
+	{
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += mantissa != 0;
+		}
+		else
+		{
+			exponent++;
+		}
+		p++;
+		anyDigits = true;
+	}
+	if (p < end && *p == '.')
+	{
+		p++;
+		while (p < end && (unsigned int)(*p - '0') < 10)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa != 0;
+				exponent--;
+			}
+			p++;
+			anyDigits = true;
+		}
+	}
+	if (!anyDigits)
+	{
+		return text;
+	}
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char* e = p + 1;
+		bool negativeExponent = false;
+		if (e < end && (*e == '-' || *e == '+'))
+		{
+			negativeExponent = *e == '-';
+			e++;
+		}
+		if (e < end && (unsigned int)(*e - '0') < 10)
+		{
+			int written = 0;
+			while (e < end && (unsigned int)(*e - '0') < 10)
+			{
+				written = std::min(written * 10 + (*e - '0'), 100000);
+				e++;
+			}
+			exponent += negativeExponent ? -written : written;
+			p = e;
+		}
+	}
+
+	double result = (double)mantissa;
+	if (exponent < 0)
+	{
+		result = exponent >= -22 ? result / Pow10[-exponent] : result * pow(10.0, exponent);
+	}
+	else if (exponent > 0)
+	{
+		result = exponent <= 22 ? result * Pow10[exponent] : result * pow(10.0, exponent);
+	}
+	value = (float)(negative ? -result : result);
+	return p;
+}
+
+static const char* ParseInt(const char* p, const char* end, int& value)
+{
+	bool negative = false;
+	if (p < end && *p == '-')
+	{
+		negative = true;
+		p++;
+	}
+	int result = 0;
+	while (p < end && (unsigned int)(*p - '0') < 10)
+	{
+		result = result * 10 + (*p - '0');
+		p++;
+	}
+	value = negative ? -result : result;
+	return p;
+}
+
+// One face corner as written. Positive indices are already global, negative ones count back from the corner's own
+// chunk and are stored chunk relative until the chunks are stitched
+struct OBJCorner
+{
+	int32_t Index[3];
+	// Bit k: component k present, bit k + 3: component k is chunk relative
+	uint8_t Flags;
+};
+
+struct OBJChunk
+{
+	std::vector<float> Positions;
+	std::vector<float> Colors;
+	std::vector<float> TexCoords;
+	std::vector<float> Normals;
+	std::vector<OBJCorner> Corners;
+	bool HasColors = false;
+};
+
+/// <summary>
+/// Reads "v", "vt", "vn" and "f" lines in [begin, end), everything else is skipped
+/// </summary>
+static void ParseOBJChunk(const char* begin, const char* end, OBJChunk& chunk)
+{
+	std::vector<OBJCorner> polygon;
+	const char* p = begin;
+	while (p < end)
+	{
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		if (!lineEnd)
+		{
+			lineEnd = end;
+		}
+		while (p < lineEnd && (*p == ' ' || *p == '\t'))
+		{
+			p++;
+		}
+
+		if (lineEnd - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			float values[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+			const char* cursor = p + 1;
+			int count = 0;
+			while (count < 6)
+			{
+				const char* next = ParseFastFloat(cursor, lineEnd, values[count]);
+				if (next == cursor)
+				{
+					break;
+				}
+				cursor = next;
+				count++;
+			}
+			chunk.Positions.insert(chunk.Positions.end(), values, values + 3);
+			// Colors are kept for every position so they stay lined up, whether or not the file turns out to have any
+			chunk.Colors.insert(chunk.Colors.end(), values + 3, values + 6);
+			chunk.HasColors |= count >= 6;
+		}
+		else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t'))
+		{
+			float uv[2] = { 0.0f, 0.0f };
+			const char* cursor = ParseFastFloat(p + 2, lineEnd, uv[0]);
+			ParseFastFloat(cursor, lineEnd, uv[1]);
+			chunk.TexCoords.insert(chunk.TexCoords.end(), uv, uv + 2);
+		}
+		else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t'))
+		{
+			float normal[3] = { 0.0f, 0.0f, 1.0f };
+			const char* cursor = ParseFastFloat(p + 2, lineEnd, normal[0]);
+			cursor = ParseFastFloat(cursor, lineEnd, normal[1]);
+			ParseFastFloat(cursor, lineEnd, normal[2]);
+			chunk.Normals.insert(chunk.Normals.end(), normal, normal + 3);
+		}
+		else if (lineEnd - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			polygon.clear();
+			int32_t counts[3] = { (int32_t)(chunk.Positions.size() / 3), (int32_t)(chunk.TexCoords.size() / 2), (int32_t)(chunk.Normals.size() / 3) };
+			const char* cursor = p + 1;
+			while (true)
+			{
+				while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+				{
+					cursor++;
+				}
+				if (cursor >= lineEnd)
+				{
+					break;
+				}
+				OBJCorner corner = { { 0, 0, 0 }, 0 };
+				// v, v/vt, v//vn or v/vt/vn
+				for (int component = 0; component < 3; component++)
+				{
+					int written = 0;
+					cursor = ParseInt(cursor, lineEnd, written);
+					if (written > 0)
+					{
+						corner.Index[component] = written - 1;
+						corner.Flags |= 1 << component;
+					}
+					else if (written < 0)
+					{
+						corner.Index[component] = counts[component] + written;
+						corner.Flags |= (1 << component) | (8 << component);
+					}
+					if (cursor >= lineEnd || *cursor != '/')
+					{
+						break;
+					}
+					cursor++;
+				}
+				// Anything else in the token is not ours to read
+				while (cursor < lineEnd && *cursor != ' ' && *cursor != '\t')
+				{
+					cursor++;
+				}
+				if (corner.Flags & 1)
+				{
+					polygon.push_back(corner);
+				}
+			}
+			for (size_t i = 2; i < polygon.size(); i++)
+			{
+				chunk.Corners.push_back(polygon[0]);
+				chunk.Corners.push_back(polygon[i - 1]);
+				chunk.Corners.push_back(polygon[i]);
+			}
+		}
+		p = lineEnd + 1;
+	}
+}
+
+bool ImportedMesh::HasNormals() const
+{
+	return FloatsPerVertex > 8;
+}
+
+size_t ImportedMesh::VertexCount() const
+{
+	return Vertices.size() / FloatsPerVertex;
+}
+
+VertexLayout ImportedMesh::Layout() const
+{
+	VertexLayout layout;
+	layout.Add(0, VertexType::Float, 3).Add(1, VertexType::UNorm8, 3).Add(2, VertexType::Half, 2);
+	if (HasNormals())
+	{
+		layout.Add(ImportNormalLocation, VertexType::Octahedral, 3);
+	}
+	return layout;
+}
+
+/// <summary>
+/// Parses a whole OBJ file's text into one indexed mesh
+/// </summary>
+/// <param name="pool"> chunks are parsed here, nullptr parses on this thread </param>
+bool ParseOBJ(const char* text, size_t length, ImportedMesh& mesh, ThreadPool* pool)
+{
+	ProfileZone zone("OBJ parse");
+	mesh = ImportedMesh();
+
+	// Chunk edges move forward to the next line break so no line is split
+	size_t chunkCount = 1;
+	if (pool)
+	{
+		chunkCount = std::max<size_t>(1, std::min<size_t>(pool->ThreadCount() * OBJChunksPerThread, length / OBJMinChunkBytes));
+	}
+	std::vector<size_t> edges(chunkCount + 1, length);
+	edges[0] = 0;
+	for (size_t chunk = 1; chunk < chunkCount; chunk++)
+	{
+		size_t edge = std::max(edges[chunk - 1], length / chunkCount * chunk);
+		const char* lineBreak = (const char*)memchr(text + edge, '\n', length - edge);
+		edges[chunk] = lineBreak ? (size_t)(lineBreak - text) + 1 : length;
+	}
+
+	std::vector<OBJChunk> chunks(chunkCount);
+	if (pool && chunkCount > 1)
+	{
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			pool->Submit([text, &edges, &chunks, chunk]()
+			{
+				ProfileZone chunkZone("OBJ chunk");
+				ParseOBJChunk(text + edges[chunk], text + edges[chunk + 1], chunks[chunk]);
+			});
+		}
+		pool->WaitIdle();
+	}
+	else
+	{
+		ParseOBJChunk(text, text + length, chunks[0]);
+	}
+
+	ProfileZone stitchZone("OBJ stitch");
+	std::vector<float> positions;
+	std::vector<float> colors;
+	std::vector<float> texCoords;
+	std::vector<float> normals;
+	bool hasColors = false;
+	size_t cornerCount = 0;
+	for (const OBJChunk& chunk : chunks)
+	{
+		positions.insert(positions.end(), chunk.Positions.begin(), chunk.Positions.end());
+		colors.insert(colors.end(), chunk.Colors.begin(), chunk.Colors.end());
+		texCoords.insert(texCoords.end(), chunk.TexCoords.begin(), chunk.TexCoords.end());
+		normals.insert(normals.end(), chunk.Normals.begin(), chunk.Normals.end());
+		hasColors |= chunk.HasColors;
+		cornerCount += chunk.Corners.size();
+	}
+	size_t positionCount = positions.size() / 3;
+	if (positionCount == 0 || cornerCount == 0)
+	{
+		std::cout << "ERROR::OBJ::NO_GEOMETRY" << std::endl;
+		return false;
+	}
+	size_t limits[3] = { positionCount, texCoords.size() / 2, normals.size() / 3 };
+
+	mesh.FloatsPerVertex = normals.empty() ? 8 : 11;
+	mesh.Indices.reserve(cornerCount);
+	mesh.Vertices.reserve(positionCount * mesh.FloatsPerVertex);
+	// Vertices made from each position chain through next, so finding an existing position/uv/normal combination
+	// only looks at the few vertices sharing that position
+	std::vector<uint32_t> firstVertex(positionCount, UINT32_MAX);
+	std::vector<uint32_t> nextVertex;
+	std::vector<int32_t> vertexTexCoord;
+	std::vector<int32_t> vertexNormal;
+	nextVertex.reserve(positionCount);
+	vertexTexCoord.reserve(positionCount);
+	vertexNormal.reserve(positionCount);
+
+	int32_t bases[3] = { 0, 0, 0 };
+	for (const OBJChunk& chunk : chunks)
+	{
+		for (const OBJCorner& corner : chunk.Corners)
+		{
+			int32_t resolved[3] = { -1, -1, -1 };
+			for (int component = 0; component < 3; component++)
+			{
+				if (!(corner.Flags & (1 << component)))
+				{
+					continue;
+				}
+				int32_t index = corner.Index[component] + ((corner.Flags & (8 << component)) ? bases[component] : 0);
+				if (index < 0 || (size_t)index >= limits[component])
+				{
+					std::cout << "ERROR::OBJ::INDEX_OUT_OF_RANGE " << corner.Index[component] << std::endl;
+					return false;
+				}
+				resolved[component] = index;
+			}
+
+			uint32_t vertex = firstVertex[resolved[0]];
+			while (vertex != UINT32_MAX && (vertexTexCoord[vertex] != resolved[1] || vertexNormal[vertex] != resolved[2]))
+			{
+				vertex = nextVertex[vertex];
+			}
+			if (vertex == UINT32_MAX)
+			{
+				vertex = (uint32_t)nextVertex.size();
+				nextVertex.push_back(firstVertex[resolved[0]]);
+				firstVertex[resolved[0]] = vertex;
+				vertexTexCoord.push_back(resolved[1]);
+				vertexNormal.push_back(resolved[2]);
+
+				const float* position = &positions[resolved[0] * 3];
+				const float* color = hasColors ? &colors[resolved[0] * 3] : nullptr;
+				float uv[2] = { 0.0f, 0.0f };
+				if (resolved[1] >= 0)
+				{
+					uv[0] = texCoords[resolved[1] * 2];
+					uv[1] = texCoords[resolved[1] * 2 + 1];
+				}
+				float out[11] = { position[0], position[1], position[2], color ? color[0] : 1.0f, color ? color[1] : 1.0f,
+					color ? color[2] : 1.0f, uv[0], uv[1], 0.0f, 0.0f, 1.0f };
+				if (resolved[2] >= 0)
+				{
+					memcpy(out + 8, &normals[resolved[2] * 3], 3 * sizeof(float));
+				}
+				mesh.Vertices.insert(mesh.Vertices.end(), out, out + mesh.FloatsPerVertex);
+			}
+			mesh.Indices.push_back(vertex);
+		}
+		bases[0] += (int32_t)(chunk.Positions.size() / 3);
+		bases[1] += (int32_t)(chunk.TexCoords.size() / 2);
+		bases[2] += (int32_t)(chunk.Normals.size() / 3);
+	}
+	return true;
+}
+
+/// <summary>
+/// Maps an OBJ file and parses it, the text is read straight from the mapping
+/// </summary>
+bool ImportOBJ(const std::string& path, ImportedMesh& mesh, ThreadPool* pool)
+{
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		std::cout << "ERROR::OBJ::FILE_NOT_READ " << path << std::endl;
+		return false;
+	}
+	return ParseOBJ((const char*)file.Data(), file.Size(), mesh, pool);
+}
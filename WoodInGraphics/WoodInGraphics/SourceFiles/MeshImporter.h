@@ -0,0 +1,54 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Wavefront OBJ import. The text is split into chunks at line breaks and each chunk is parsed on the
+/// thread pool into its own positions, texture coordinates, normals and face corners, numbers go through a hand
+/// written float parser instead of strtod. The chunks are then stitched together in order, relative (negative)
+/// indices resolved against the chunk they came from, and every distinct position/uv/normal combination becomes one
+/// vertex. Polygons are triangulated as fans. Materials, groups and smoothing groups are ignored.
+/// Output vertices are 8 floats (position, color, uv) like _vertices, plus 3 for the normal when the file has them;
+/// colors come from the "v x y z r g b" extension and are white otherwise.
+/// -----------------
+
+#ifndef MESH_IMPORTER_H
+#define MESH_IMPORTER_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "VertexLayout.h"
+
+#pragma endregion Includes
+
+class ThreadPool;
+
+// Shader location imported normals are bound to, after the instance attributes
+const unsigned int ImportNormalLocation = 9;
+
+struct ImportedMesh
+{
+	std::vector<float> Vertices;
+	// 8, or 11 with normals
+	unsigned int FloatsPerVertex = 8;
+	std::vector<uint32_t> Indices;
+
+	bool HasNormals() const;
+	size_t VertexCount() const;
+	// Compact layout for uploading: float positions (imported models can be any size), byte colors, half uvs (OBJ
+	// uvs may tile past 1) and octahedral normals
+	VertexLayout Layout() const;
+};
+
+// Parses OBJ text, in chunks on pool when it is given. False if nothing could be read
+bool ParseOBJ(const char* text, size_t length, ImportedMesh& mesh, ThreadPool* pool = nullptr);
+// Maps the file and parses it in place
+bool ImportOBJ(const std::string& path, ImportedMesh& mesh, ThreadPool* pool = nullptr);
+
+// Parses a decimal float at text, returns the character after it or text if there was no number
+const char* ParseFastFloat(const char* text, const char* end, float& value);
+
+#endif // !MESH_IMPORTER_H
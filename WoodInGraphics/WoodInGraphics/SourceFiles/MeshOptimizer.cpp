@@ -0,0 +1,409 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Vertex cache, overdraw and vertex fetch optimization for triangle lists
+/// -----------------
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+#include "MeshOptimizer.h"
+
+// Cache the Forsyth scores model, bigger than any real GPU's so the order also suits bigger caches
+const unsigned int ForsythCacheSize = 32;
+const unsigned int ForsythMaxValence = 32;
+
+/// <summary>
+/// Runs indices through a FIFO cache of cacheSize vertices
+/// </summary>
+/// <returns> ACMR and ATVR, zero for an empty mesh </returns>
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats;
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+	{
+		return stats;
+	}
+
+	// A vertex is cached while fewer than cacheSize misses have happened since it went in, which is a FIFO of that size
+	// without moving anything. Starting the clock past cacheSize makes every vertex miss the first time
+	std::vector<uint32_t> insertedAt(vertexCount, 0);
+	std::vector<bool> used(vertexCount, false);
+	uint32_t clock = cacheSize + 1;
+	size_t transforms = 0;
+	size_t usedVertices = 0;
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		uint32_t vertex = indices[i];
+		if (clock - insertedAt[vertex] > cacheSize)
+		{
+			insertedAt[vertex] = clock++;
+			transforms++;
+		}
+		if (!used[vertex])
+		{
+			used[vertex] = true;
+			usedVertices++;
+		}
+	}
+	stats.Acmr = (float)transforms / triangleCount;
+	stats.Atvr = (float)transforms / usedVertices;
+	return stats;
+}
+
+/// <summary>
+/// Reorders triangles for vertex reuse. Each step emits the highest scoring triangle touching the modelled cache,
+/// vertices score for being recently used and for having few triangles left so fans get finished instead of abandoned
+/// </summary>
+void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	float cacheScores[ForsythCacheSize];
+	for (unsigned int position = 0; position < ForsythCacheSize; position++)
+	{
+		// The last triangle's three vertices score the same, past them the score falls off with age
+		cacheScores[position] = position < 3 ? 0.75f : powf(1.0f - (float)(position - 3) / (ForsythCacheSize - 3), 1.5f);
+	}
+	float valenceScores[ForsythMaxValence + 1];
+	valenceScores[0] = 0.0f;
+	for (unsigned int valence = 1; valence <= ForsythMaxValence; valence++)
+	{
+		valenceScores[valence] = 2.0f / sqrtf((float)valence);
+	}
+	auto vertexScore = [&](int position, uint32_t remaining)
+	{
+		if (remaining == 0)
+		{
+			return -1.0f;
+		}
+		float score = position >= 0 ? cacheScores[position] : 0.0f;
+		return score + valenceScores[std::min(remaining, ForsythMaxValence)];
+	};
+
+	// Triangles using each vertex, the first remaining[vertex] of its list are the ones not emitted yet
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		remaining[indices[i]]++;
+	}
+	std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		adjacencyStart[vertex + 1] = adjacencyStart[vertex] + remaining[vertex];
+	}
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+	}
+
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		vertexScores[vertex] = vertexScore(-1, remaining[vertex]);
+	}
+	std::vector<float> triangleScores(triangleCount);
+	int64_t best = 0;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		const uint32_t* corners = indices + triangle * 3;
+		triangleScores[triangle] = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+		if (triangleScores[triangle] > triangleScores[best])
+		{
+			best = (int64_t)triangle;
+		}
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	// Three extra slots so vertices pushed out of the modelled cache get their score dropped before they are forgotten
+	uint32_t cache[ForsythCacheSize + 3];
+	uint32_t nextCache[ForsythCacheSize + 3];
+	unsigned int cacheCount = 0;
+	size_t scanCursor = 0;
+
+	for (size_t output = 0; output < triangleCount; output++)
+	{
+		if (best < 0)
+		{
+			// Nothing in the cache has triangles left, carry on from the next unemitted one in input order
+			while (emitted[scanCursor])
+			{
+				scanCursor++;
+			}
+			best = (int64_t)scanCursor;
+		}
+
+		const uint32_t* corners = indices + best * 3;
+		memcpy(destination + output * 3, corners, 3 * sizeof(uint32_t));
+		emitted[best] = true;
+
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = corners[corner];
+			uint32_t* list = &adjacency[adjacencyStart[vertex]];
+			for (uint32_t i = 0; i < remaining[vertex]; i++)
+			{
+				if (list[i] == (uint32_t)best)
+				{
+					list[i] = list[remaining[vertex] - 1];
+					remaining[vertex]--;
+					break;
+				}
+			}
+		}
+
+		// Most recent first, the triangle's own vertices go to the front
+		unsigned int nextCount = 0;
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			if (std::find(nextCache, nextCache + nextCount, corners[corner]) == nextCache + nextCount)
+			{
+				nextCache[nextCount++] = corners[corner];
+			}
+		}
+		for (unsigned int i = 0; i < cacheCount && nextCount < ForsythCacheSize + 3; i++)
+		{
+			if (cache[i] != corners[0] && cache[i] != corners[1] && cache[i] != corners[2])
+			{
+				nextCache[nextCount++] = cache[i];
+			}
+		}
+		memcpy(cache, nextCache, nextCount * sizeof(uint32_t));
+		cacheCount = nextCount;
+
+		for (unsigned int i = 0; i < cacheCount; i++)
+		{
+			uint32_t vertex = cache[i];
+			float score = vertexScore(i < ForsythCacheSize ? (int)i : -1, remaining[vertex]);
+			float change = score - vertexScores[vertex];
+			vertexScores[vertex] = score;
+			const uint32_t* list = &adjacency[adjacencyStart[vertex]];
+			for (uint32_t j = 0; j < remaining[vertex]; j++)
+			{
+				triangleScores[list[j]] += change;
+			}
+		}
+
+		best = -1;
+		float bestScore = -1.0f;
+		for (unsigned int i = 0; i < cacheCount && i < ForsythCacheSize; i++)
+		{
+			uint32_t vertex = cache[i];
+			const uint32_t* list = &adjacency[adjacencyStart[vertex]];
+			for (uint32_t j = 0; j < remaining[vertex]; j++)
+			{
+				if (triangleScores[list[j]] > bestScore)
+				{
+					bestScore = triangleScores[list[j]];
+					best = list[j];
+				}
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Counts cache misses for one triangle on the same clock based FIFO AnalyzeVertexCache uses
+/// </summary>
+static unsigned int TriangleMisses(const uint32_t* corners, std::vector<uint32_t>& insertedAt, uint32_t& clock)
+{
+	unsigned int misses = 0;
+	for (unsigned int corner = 0; corner < 3; corner++)
+	{
+		if (clock - insertedAt[corners[corner]] > MeshStatsCacheSize)
+		{
+			insertedAt[corners[corner]] = clock++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+/// <summary>
+/// Reorders clusters of triangles so outward facing ones draw first. Clusters start wherever the cache order already
+/// starts afresh (a triangle with three misses), and are split further as long as each piece keeps its ACMR within
+/// threshold of the whole cluster's
+/// </summary>
+/// <param name="threshold"> how much worse than the cache order a cluster may get, 1.05 is 5% </param>
+void OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount,
+	size_t positionStride, float threshold)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	std::vector<uint32_t> insertedAt(vertexCount, 0);
+	uint32_t clock = MeshStatsCacheSize + 1;
+	// Moving the clock on by the cache size empties the cache
+	auto flush = [&clock]()
+	{
+		clock += MeshStatsCacheSize + 1;
+	};
+
+	std::vector<uint32_t> hardStarts;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		if (TriangleMisses(indices + triangle * 3, insertedAt, clock) == 3)
+		{
+			hardStarts.push_back((uint32_t)triangle);
+		}
+	}
+	if (hardStarts.empty() || hardStarts[0] != 0)
+	{
+		hardStarts.insert(hardStarts.begin(), 0);
+	}
+	hardStarts.push_back((uint32_t)triangleCount);
+
+	std::vector<uint32_t> clusterStarts;
+	for (size_t hard = 0; hard + 1 < hardStarts.size(); hard++)
+	{
+		uint32_t start = hardStarts[hard];
+		uint32_t end = hardStarts[hard + 1];
+		flush();
+		unsigned int clusterMisses = 0;
+		for (uint32_t triangle = start; triangle < end; triangle++)
+		{
+			clusterMisses += TriangleMisses(indices + triangle * 3, insertedAt, clock);
+		}
+		float clusterThreshold = threshold * clusterMisses / (end - start);
+
+		flush();
+		clusterStarts.push_back(start);
+		uint32_t softStart = start;
+		unsigned int misses = 0;
+		for (uint32_t triangle = start; triangle + 1 < end; triangle++)
+		{
+			misses += TriangleMisses(indices + triangle * 3, insertedAt, clock);
+			if (misses <= clusterThreshold * (triangle + 1 - softStart))
+			{
+				// The piece so far is cheap enough on its own, the next one starts with an empty cache as it may move
+				clusterStarts.push_back(triangle + 1);
+				softStart = triangle + 1;
+				misses = 0;
+				flush();
+			}
+		}
+	}
+	clusterStarts.push_back((uint32_t)triangleCount);
+
+	auto position = [&](uint32_t vertex)
+	{
+		const float* p = (const float*)((const unsigned char*)positions + vertex * positionStride);
+		return glm::vec3(p[0], p[1], p[2]);
+	};
+
+	// Area weighted centroid and normal of each cluster, and of the whole mesh
+	size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (size_t cluster = 0; cluster < clusterCount; cluster++)
+	{
+		float area = 0.0f;
+		for (uint32_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; triangle++)
+		{
+			const uint32_t* corners = indices + triangle * 3;
+			glm::vec3 a = position(corners[0]);
+			glm::vec3 b = position(corners[1]);
+			glm::vec3 c = position(corners[2]);
+			glm::vec3 cross = glm::cross(b - a, c - a);
+			float triangleArea = glm::length(cross);
+			centroids[cluster] += (a + b + c) * (triangleArea / 3.0f);
+			normals[cluster] += cross;
+			area += triangleArea;
+		}
+		meshCentroid += centroids[cluster];
+		meshArea += area;
+		if (area > 0.0f)
+		{
+			centroids[cluster] /= area;
+		}
+	}
+	if (meshArea > 0.0f)
+	{
+		meshCentroid /= meshArea;
+	}
+
+	// Further out along its own facing draws earlier, it is the most likely to cover the rest
+	std::vector<float> keys(clusterCount);
+	std::vector<uint32_t> order(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; cluster++)
+	{
+		float length = glm::length(normals[cluster]);
+		keys[cluster] = length > 0.0f ? glm::dot(centroids[cluster] - meshCentroid, normals[cluster] / length) : 0.0f;
+		order[cluster] = (uint32_t)cluster;
+	}
+	std::stable_sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b)
+	{
+		return keys[a] > keys[b];
+	});
+
+	size_t output = 0;
+	for (uint32_t cluster : order)
+	{
+		size_t first = clusterStarts[cluster] * 3;
+		size_t count = (clusterStarts[cluster + 1] - clusterStarts[cluster]) * 3;
+		memcpy(destination + output, indices + first, count * sizeof(uint32_t));
+		output += count;
+	}
+}
+
+/// <summary>
+/// Renumbers vertices in first use order
+/// </summary>
+/// <param name="destination"> room for vertexCount vertices, must not alias vertices </param>
+size_t OptimizeVertexFetch(void* destination, uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride)
+{
+	std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+	uint32_t next = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		uint32_t vertex = indices[i];
+		if (remap[vertex] == UINT32_MAX)
+		{
+			remap[vertex] = next;
+			memcpy((unsigned char*)destination + next * vertexStride, (const unsigned char*)vertices + vertex * vertexStride, vertexStride);
+			next++;
+		}
+		indices[i] = remap[vertex];
+	}
+	return next;
+}
+
+/// <summary>
+/// Runs the cache, overdraw and fetch passes in that order
+/// </summary>
+/// <param name="vertices"> floatsPerVertex floats each, position first, rewritten in fetch order </param>
+/// <param name="indices"> triangle list, rewritten, a trailing partial triangle is dropped </param>
+/// <returns> cache stats of the mesh as it came in and as it went out </returns>
+MeshOptimizeReport OptimizeMesh(std::vector<float>& vertices, unsigned int floatsPerVertex, std::vector<uint32_t>& indices)
+{
+	MeshOptimizeReport report;
+	indices.resize(indices.size() - indices.size() % 3);
+	size_t vertexCount = vertices.size() / floatsPerVertex;
+	size_t stride = floatsPerVertex * sizeof(float);
+	report.Before = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+	std::vector<uint32_t> cacheOrder(indices.size());
+	OptimizeVertexCache(cacheOrder.data(), indices.data(), indices.size(), vertexCount);
+	OptimizeOverdraw(indices.data(), cacheOrder.data(), cacheOrder.size(), vertices.data(), vertexCount, stride);
+
+	std::vector<float> fetchOrder(vertices.size());
+	size_t usedVertices = OptimizeVertexFetch(fetchOrder.data(), indices.data(), indices.size(), vertices.data(), vertexCount, stride);
+	fetchOrder.resize(usedVertices * floatsPerVertex);
+	vertices.swap(fetchOrder);
+
+	report.After = AnalyzeVertexCache(indices.data(), indices.size(), usedVertices);
+	return report;
+}
@@ -0,0 +1,58 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Reorders a triangle mesh before upload so the GPU does less work drawing it, nothing here touches GL
+/// so it runs the same in the app and in offline tools. The passes, in the order OptimizeMesh runs them:
+///   vertex cache  triangle order that reuses recently transformed vertices (Forsyth's linear speed algorithm)
+///   overdraw      moves whole clusters of that order so outward facing parts draw first and hide what is behind,
+///                 clusters keep the cache order inside them so ACMR only gets slightly worse (the threshold)
+///   vertex fetch  renumbers vertices in the order the indices first use them so fetches walk memory forwards
+/// Results are measured as ACMR (vertices transformed per triangle, 0.5 is the best a regular grid can do, 3 is no
+/// reuse at all) and ATVR (vertices transformed per vertex, 1 is ideal), both on a 16 entry FIFO cache.
+/// -----------------
+
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#pragma endregion Includes
+
+const unsigned int MeshStatsCacheSize = 16;
+// Cluster ACMR may grow by this factor when the overdraw pass splits the cache order up
+const float DefaultOverdrawThreshold = 1.05f;
+
+struct VertexCacheStats
+{
+	// Average cache miss ratio, transformed vertices per triangle
+	float Acmr = 0.0f;
+	// Average transform to vertex ratio, transformed vertices per vertex used
+	float Atvr = 0.0f;
+};
+
+struct MeshOptimizeReport
+{
+	VertexCacheStats Before;
+	VertexCacheStats After;
+};
+
+// Simulates a FIFO post transform cache over a triangle list
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = MeshStatsCacheSize);
+
+// destination gets the reordered triangle list, it must not alias indices
+void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+// Expects indices already cache optimized. positions are 3 floats each, positionStride bytes apart
+void OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount,
+	size_t positionStride, float threshold = DefaultOverdrawThreshold);
+// Rewrites indices in place and fills destination with the vertices in first use order, unused vertices are dropped
+// Returns how many vertices destination holds
+size_t OptimizeVertexFetch(void* destination, uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride);
+
+// All three passes over float vertices with the position in the first three floats
+MeshOptimizeReport OptimizeMesh(std::vector<float>& vertices, unsigned int floatsPerVertex, std::vector<uint32_t>& indices);
+
+#endif // !MESH_OPTIMIZER_H
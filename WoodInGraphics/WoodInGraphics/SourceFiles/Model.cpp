@@ -0,0 +1,373 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: glTF binary loading and imported mesh upload
+/// -----------------
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#include "GLStateCache.h"
+#include "IndexBuffer.h"
+#include "Json.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "Model.h"
+#include "Profiler.h"
+
+const uint32_t GLBMagic = 0x46546C67;
+const uint32_t GLBChunkJSON = 0x4E4F534A;
+const uint32_t GLBChunkBIN = 0x004E4942;
+// Buffer views are placed this far apart in the GL buffer, enough for any attribute or index alignment
+const size_t ModelViewAlignment = 16;
+
+static uint32_t ReadGLBU32(const unsigned char* data)
+{
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+/// <summary>
+/// Components per element of a glTF accessor type, 0 for matrices and anything unknown
+/// </summary>
+static int AccessorComponents(const std::string& type)
+{
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	return 0;
+}
+
+static size_t ComponentTypeSize(unsigned int componentType)
+{
+	switch (componentType)
+	{
+	case GL_BYTE:
+	case GL_UNSIGNED_BYTE:
+		return 1;
+	case GL_SHORT:
+	case GL_UNSIGNED_SHORT:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+Model::~Model()
+{
+	Release();
+}
+
+void Model::Release()
+{
+	GLStateCache& state = GLStateCache::Instance();
+	for (unsigned int vertexArray : _vertexArrays)
+	{
+		state.DeleteVertexArray(vertexArray);
+	}
+	_vertexArrays.clear();
+	if (_buffer != 0)
+	{
+		state.DeleteBuffer(_buffer);
+		_buffer = 0;
+	}
+	_bufferBytes = 0;
+	_primitives.clear();
+}
+
+/// <summary>
+/// Loads every indexed primitive of every mesh in a .glb
+/// </summary>
+/// <returns> false if the file could not be read or nothing in it could be drawn </returns>
+bool Model::LoadGLB(const std::string& path)
+{
+	ProfileZone zone("Load glTF");
+	Release();
+
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		std::cout << "ERROR::GLTF::FILE_NOT_READ " << path << std::endl;
+		return false;
+	}
+	const unsigned char* data = file.Data();
+	size_t size = file.Size();
+	if (size < 20 || ReadGLBU32(data) != GLBMagic || ReadGLBU32(data + 4) != 2)
+	{
+		std::cout << "ERROR::GLTF::NOT_GLB_VERSION_2 " << path << std::endl;
+		return false;
+	}
+
+	// The JSON chunk comes first, the binary chunk (if any) right after it
+	const char* json = nullptr;
+	size_t jsonLength = 0;
+	const unsigned char* binary = nullptr;
+	size_t binaryLength = 0;
+	size_t offset = 12;
+	while (offset + 8 <= size)
+	{
+		uint32_t chunkLength = ReadGLBU32(data + offset);
+		uint32_t chunkType = ReadGLBU32(data + offset + 4);
+		if (offset + 8 + (size_t)chunkLength > size)
+		{
+			break;
+		}
+		if (chunkType == GLBChunkJSON && !json)
+		{
+			json = (const char*)data + offset + 8;
+			jsonLength = chunkLength;
+		}
+		else if (chunkType == GLBChunkBIN && !binary)
+		{
+			binary = data + offset + 8;
+			binaryLength = chunkLength;
+		}
+		offset += 8 + AlignUp(chunkLength, 4);
+	}
+	JsonValue document;
+	if (!json || !ParseJson(json, jsonLength, document))
+	{
+		std::cout << "ERROR::GLTF::BAD_JSON " << path << std::endl;
+		return false;
+	}
+
+	const JsonValue* meshes = document.Find("meshes");
+	const JsonValue* accessors = document.Find("accessors");
+	const JsonValue* bufferViews = document.Find("bufferViews");
+	if (!meshes || !accessors || !bufferViews || !binary)
+	{
+		std::cout << "ERROR::GLTF::NO_MESH_DATA " << path << std::endl;
+		return false;
+	}
+
+	// An accessor checked against its buffer view, everything needed to point GL at it
+	struct Accessor
+	{
+		int View;
+		size_t Offset;
+		unsigned int ComponentType;
+		int Components;
+		bool Normalized;
+		size_t Count;
+		size_t Stride;
+	};
+	auto readAccessor = [&](int index, Accessor& accessor)
+	{
+		const JsonValue* source = accessors->At(index);
+		if (!source || source->Find("sparse") || !source->Find("bufferView"))
+		{
+			return false;
+		}
+		accessor.View = source->IntOr("bufferView", -1);
+		accessor.Offset = (size_t)source->NumberOr("byteOffset", 0.0);
+		accessor.ComponentType = (unsigned int)source->IntOr("componentType", 0);
+		const JsonValue* type = source->Find("type");
+		accessor.Components = type && type->Type == JsonType::String ? AccessorComponents(type->String) : 0;
+		const JsonValue* normalized = source->Find("normalized");
+		accessor.Normalized = normalized && normalized->Type == JsonType::Bool && normalized->Bool;
+		accessor.Count = (size_t)source->NumberOr("count", 0.0);
+
+		const JsonValue* view = bufferViews->At(accessor.View);
+		if (!view || accessor.Components == 0 || accessor.Count == 0 || view->IntOr("buffer", 0) != 0)
+		{
+			return false;
+		}
+		size_t viewOffset = (size_t)view->NumberOr("byteOffset", 0.0);
+		size_t viewLength = (size_t)view->NumberOr("byteLength", 0.0);
+		size_t elementSize = accessor.Components * ComponentTypeSize(accessor.ComponentType);
+		accessor.Stride = (size_t)view->NumberOr("byteStride", 0.0);
+		size_t step = accessor.Stride != 0 ? accessor.Stride : elementSize;
+		// The last element has to end inside the view, and the view inside the binary chunk
+		return viewOffset + viewLength <= binaryLength && accessor.Offset + (accessor.Count - 1) * step + elementSize <= viewLength;
+	};
+
+	struct PendingPrimitive
+	{
+		unsigned int Mode;
+		Accessor Indices;
+		Accessor Attributes[4];
+		bool HasAttribute[4];
+	};
+	const char* attributeNames[4] = { "POSITION", "COLOR_0", "TEXCOORD_0", "NORMAL" };
+	const unsigned int attributeLocations[4] = { 0, 1, 2, ImportNormalLocation };
+
+	std::vector<PendingPrimitive> pending;
+	// Buffer view index to its offset in the GL buffer, only views something uses are uploaded
+	std::unordered_map<int, size_t> viewPlacement;
+	size_t bufferBytes = 0;
+	auto placeView = [&](int view)
+	{
+		if (viewPlacement.count(view) == 0)
+		{
+			viewPlacement[view] = bufferBytes;
+			bufferBytes = AlignUp(bufferBytes + (size_t)bufferViews->At(view)->NumberOr("byteLength", 0.0), ModelViewAlignment);
+		}
+	};
+
+	for (const JsonValue& mesh : meshes->Array)
+	{
+		const JsonValue* primitives = mesh.Find("primitives");
+		if (!primitives)
+		{
+			continue;
+		}
+		for (const JsonValue& primitive : primitives->Array)
+		{
+			PendingPrimitive entry = {};
+			entry.Mode = (unsigned int)primitive.IntOr("mode", GL_TRIANGLES);
+			const JsonValue* attributes = primitive.Find("attributes");
+			const JsonValue* position = attributes ? attributes->Find("POSITION") : nullptr;
+			if (!primitive.Find("indices") || !position)
+			{
+				std::cout << "ERROR::GLTF::UNINDEXED_PRIMITIVE_SKIPPED" << std::endl;
+				continue;
+			}
+			if (!readAccessor(primitive.IntOr("indices", -1), entry.Indices) || entry.Indices.Components != 1 ||
+				(entry.Indices.ComponentType != GL_UNSIGNED_BYTE && entry.Indices.ComponentType != GL_UNSIGNED_SHORT &&
+				entry.Indices.ComponentType != GL_UNSIGNED_INT))
+			{
+				std::cout << "ERROR::GLTF::BAD_INDEX_ACCESSOR" << std::endl;
+				continue;
+			}
+			bool valid = true;
+			for (int attribute = 0; attribute < 4; attribute++)
+			{
+				const JsonValue* index = attributes->Find(attributeNames[attribute]);
+				if (!index || index->Type != JsonType::Number)
+				{
+					continue;
+				}
+				entry.HasAttribute[attribute] = readAccessor((int)index->Number, entry.Attributes[attribute]);
+				valid &= entry.HasAttribute[attribute];
+			}
+			if (!valid || !entry.HasAttribute[0])
+			{
+				std::cout << "ERROR::GLTF::BAD_ATTRIBUTE_ACCESSOR" << std::endl;
+				continue;
+			}
+			placeView(entry.Indices.View);
+			for (int attribute = 0; attribute < 4; attribute++)
+			{
+				if (entry.HasAttribute[attribute])
+				{
+					placeView(entry.Attributes[attribute].View);
+				}
+			}
+			pending.push_back(entry);
+		}
+	}
+	if (pending.empty())
+	{
+		std::cout << "ERROR::GLTF::NO_DRAWABLE_PRIMITIVES " << path << std::endl;
+		return false;
+	}
+
+	// Straight from the mapped file into the buffer, one copy per view and none on the CPU side
+	GLStateCache& state = GLStateCache::Instance();
+	glGenBuffers(1, &_buffer);
+	state.BindBuffer(GL_ARRAY_BUFFER, _buffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)bufferBytes, NULL, GL_STATIC_DRAW);
+	for (const std::pair<const int, size_t>& placement : viewPlacement)
+	{
+		const JsonValue* view = bufferViews->At(placement.first);
+		size_t viewOffset = (size_t)view->NumberOr("byteOffset", 0.0);
+		size_t viewLength = (size_t)view->NumberOr("byteLength", 0.0);
+		glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)placement.second, (GLsizeiptr)viewLength, binary + viewOffset);
+	}
+	_bufferBytes = bufferBytes;
+	Profiler::Instance().CountUploadBytes(bufferBytes);
+
+	for (const PendingPrimitive& entry : pending)
+	{
+		unsigned int vertexArray;
+		glGenVertexArrays(1, &vertexArray);
+		_vertexArrays.push_back(vertexArray);
+		state.BindVertexArray(vertexArray);
+		state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, _buffer);
+		for (int attribute = 0; attribute < 4; attribute++)
+		{
+			if (!entry.HasAttribute[attribute])
+			{
+				continue;
+			}
+			const Accessor& accessor = entry.Attributes[attribute];
+			glVertexAttribPointer(attributeLocations[attribute], accessor.Components, accessor.ComponentType,
+				accessor.Normalized ? GL_TRUE : GL_FALSE, (GLsizei)accessor.Stride, (void*)(viewPlacement[accessor.View] + accessor.Offset));
+			glEnableVertexAttribArray(attributeLocations[attribute]);
+		}
+
+		ModelPrimitive primitive;
+		primitive.VertexArray = vertexArray;
+		primitive.Mode = entry.Mode;
+		primitive.IndexType = entry.Indices.ComponentType;
+		primitive.IndexCount = (unsigned int)entry.Indices.Count;
+		primitive.IndexOffset = viewPlacement[entry.Indices.View] + entry.Indices.Offset;
+		_primitives.push_back(primitive);
+	}
+	state.BindVertexArray(0);
+	state.BindBuffer(GL_ARRAY_BUFFER, 0);
+	return true;
+}
+
+/// <summary>
+/// Uploads an imported mesh, optimized for the vertex cache, in the compact layout and with 16 bit indices
+/// </summary>
+/// <param name="mesh"> taken by value, the optimizer reorders it </param>
+void Model::Create(ImportedMesh mesh)
+{
+	ProfileZone zone("Upload imported mesh");
+	Release();
+	OptimizeMesh(mesh.Vertices, mesh.FloatsPerVertex, mesh.Indices);
+	VertexLayout layout = mesh.Layout();
+	std::vector<unsigned char> vertices = layout.Encode(mesh.Vertices.data(), mesh.VertexCount());
+	IndexBufferData indices = BuildIndexBuffer(mesh.Indices.data(), (unsigned int)mesh.Indices.size(), (unsigned int)mesh.VertexCount());
+
+	// Vertices then indices in the one buffer
+	size_t indexStart = AlignUp(vertices.size(), ModelViewAlignment);
+	_bufferBytes = indexStart + indices.Bytes.size();
+	GLStateCache& state = GLStateCache::Instance();
+	unsigned int vertexArray;
+	glGenVertexArrays(1, &vertexArray);
+	_vertexArrays.push_back(vertexArray);
+	glGenBuffers(1, &_buffer);
+	state.BindVertexArray(vertexArray);
+	state.BindBuffer(GL_ARRAY_BUFFER, _buffer);
+	state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, _buffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)_bufferBytes, NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)vertices.size(), vertices.data());
+	glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)indexStart, (GLsizeiptr)indices.Bytes.size(), indices.Bytes.data());
+	Profiler::Instance().CountUploadBytes(_bufferBytes);
+	layout.Apply();
+
+	for (const IndexRange& range : indices.Ranges)
+	{
+		ModelPrimitive primitive;
+		primitive.VertexArray = vertexArray;
+		primitive.IndexType = indices.Type;
+		primitive.IndexCount = range.Count;
+		primitive.IndexOffset = indexStart + range.Offset;
+		primitive.BaseVertex = range.BaseVertex;
+		_primitives.push_back(primitive);
+	}
+	state.BindVertexArray(0);
+	state.BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+const std::vector<ModelPrimitive>& Model::GetPrimitives() const
+{
+	return _primitives;
+}
+
+size_t Model::GetBufferBytes() const
+{
+	return _bufferBytes;
+}
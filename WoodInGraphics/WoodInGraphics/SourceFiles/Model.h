@@ -0,0 +1,66 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Imported geometry on the GPU, one vertex array per primitive and a single buffer holding every
+/// primitive's vertices and indices.
+/// Binary glTF (.glb) is memory mapped and each buffer view a mesh uses is copied from the mapping straight into the
+/// GL buffer, the accessors then become attribute pointers as they are (type, normalized, stride, offset), so the
+/// data is never decoded, converted or copied on the CPU. Attributes go to the shader locations _vertices uses:
+///   POSITION 0 | COLOR_0 1 | TEXCOORD_0 2 | NORMAL ImportNormalLocation
+/// Node transforms, materials, skins, morph targets, sparse accessors and unindexed primitives are not handled.
+/// OBJ meshes come through MeshImporter and are optimized, compacted and 16 bit indexed on the way in.
+/// -----------------
+
+#ifndef MODEL_H
+#define MODEL_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "MeshImporter.h"
+
+#pragma endregion Includes
+
+// What a DrawPacket needs to draw one primitive
+struct ModelPrimitive
+{
+	unsigned int VertexArray = 0;
+	// GL_TRIANGLES unless the file says otherwise
+	unsigned int Mode = 0x0004;
+	unsigned int IndexType = 0x1403;
+	unsigned int IndexCount = 0;
+	size_t IndexOffset = 0;
+	int BaseVertex = 0;
+};
+
+class Model
+{
+public:
+
+	Model() = default;
+	~Model();
+
+	Model(const Model&) = delete;
+	Model& operator=(const Model&) = delete;
+
+	// GL thread only. Both replace whatever was loaded before
+	bool LoadGLB(const std::string& path);
+	void Create(ImportedMesh mesh);
+	void Release();
+
+	const std::vector<ModelPrimitive>& GetPrimitives() const;
+	// Bytes of vertex and index data uploaded
+	size_t GetBufferBytes() const;
+
+private:
+
+	unsigned int _buffer = 0;
+	size_t _bufferBytes = 0;
+	std::vector<unsigned int> _vertexArrays;
+	std::vector<ModelPrimitive> _primitives;
+};
+
+#endif // !MODEL_H
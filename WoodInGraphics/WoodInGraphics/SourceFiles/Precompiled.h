@@ -0,0 +1,35 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Headers nearly every file includes and that rarely change, compiled once per build by CMake
+/// (WIG_PRECOMPILED_HEADERS) and force included ahead of each C++ file. Files still include what they use, this only
+/// saves parsing them over and over, so only add headers here that are stable and widely used.
+/// -----------------
+
+#ifndef PRECOMPILED_H
+#define PRECOMPILED_H
+
+#pragma region Includes
+
+// GLAD must be added before GLFW
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#pragma endregion Includes
+
+#endif // !PRECOMPILED_H
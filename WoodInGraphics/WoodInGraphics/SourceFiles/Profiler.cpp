@@ -0,0 +1,339 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: CPU zones, GPU timer queries and Chrome trace export
+/// -----------------
+#include <glad/glad.h>
+
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+#include "Profiler.h"
+
+// Keeps a forgotten capture from eating all the memory, roughly 40MB of events
+const size_t MaxTraceEvents = 1 << 20;
+
+// Thread index used for GPU passes in the trace, real threads count up from 0
+const unsigned int GpuTraceThread = 1000;
+
+Profiler& Profiler::Instance()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::Profiler()
+	: _epoch(Clock::now())
+{
+}
+
+std::vector<Profiler::OpenZone>& Profiler::ZoneStack()
+{
+	thread_local std::vector<OpenZone> stack;
+	return stack;
+}
+
+double Profiler::MicrosecondsSinceEpoch(Clock::time_point time) const
+{
+	return std::chrono::duration<double, std::micro>(time - _epoch).count();
+}
+
+/// <summary>
+/// Small stable number for the calling thread, the thread that started the capture gets 0
+/// </summary>
+unsigned int Profiler::ThreadIndex()
+{
+	size_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+	auto existing = _threadIndices.find(id);
+	if (existing != _threadIndices.end())
+	{
+		return existing->second;
+	}
+	unsigned int index = (unsigned int)_threadIndices.size();
+	_threadIndices[id] = index;
+	return index;
+}
+
+void Profiler::Record(const TraceEvent& event)
+{
+	std::lock_guard<std::mutex> lock(_traceMutex);
+	if (!_capturing || _events.size() >= MaxTraceEvents)
+	{
+		return;
+	}
+	TraceEvent recorded = event;
+	if (recorded.Thread != GpuTraceThread)
+	{
+		recorded.Thread = ThreadIndex();
+	}
+	_events.push_back(recorded);
+}
+
+#pragma region Frames
+
+/// <summary>
+/// Starts counting a new frame. Call before anything else in the frame
+/// </summary>
+void Profiler::BeginFrame()
+{
+	_frameStart = Clock::now();
+	_inFrame = true;
+	_drawCalls = 0;
+	_uploadBytes = 0;
+
+	// This set was resolved (or dropped) at the end of the frame before, it is free to reuse
+	QueryFrame& frame = _queryFrames[_frame % ProfilerQueryFrames];
+	frame.Passes.clear();
+	frame.Stats = ProfilerFrameStats();
+	frame.Stats.Frame = _frame;
+	frame.Pending = false;
+}
+
+/// <summary>
+/// Closes the frame and collects the GPU results of the oldest frame still in flight
+/// </summary>
+void Profiler::EndFrame()
+{
+	if (!_inFrame)
+	{
+		return;
+	}
+	_inFrame = false;
+	Clock::time_point now = Clock::now();
+
+	QueryFrame& frame = _queryFrames[_frame % ProfilerQueryFrames];
+	frame.Stats.CpuMs = std::chrono::duration<double, std::milli>(now - _frameStart).count();
+	frame.Stats.DrawCalls = _drawCalls;
+	frame.Stats.UploadBytes = _uploadBytes;
+	frame.Pending = true;
+
+	double startUs = MicrosecondsSinceEpoch(_frameStart);
+	double endUs = MicrosecondsSinceEpoch(now);
+	Record({ "Frame", 'X', 0, startUs, endUs - startUs, 0.0 });
+	Record({ "Draw calls", 'C', 0, endUs, 0.0, (double)frame.Stats.DrawCalls });
+	Record({ "Uploaded bytes", 'C', 0, endUs, 0.0, (double)frame.Stats.UploadBytes });
+
+	_frame++;
+	// The set about to be reused next frame is the oldest one in flight
+	QueryFrame& oldest = _queryFrames[_frame % ProfilerQueryFrames];
+	if (oldest.Pending)
+	{
+		ResolveQueries(oldest);
+	}
+}
+
+/// <summary>
+/// Reads back a frame's queries if the GPU has finished them, otherwise drops its GPU times rather than wait
+/// </summary>
+void Profiler::ResolveQueries(QueryFrame& frame)
+{
+	frame.Pending = false;
+	_resolvedFrames++;
+	if (!frame.Passes.empty())
+	{
+		// Queries finish in order, if the last one is done they all are
+		GLuint available = 0;
+		glGetQueryObjectuiv(frame.Passes.back().Query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+		{
+			_droppedGpuFrames++;
+			frame.Stats.GpuMs = -1.0;
+			for (const PendingPass& pass : frame.Passes)
+			{
+				frame.Stats.Passes.push_back({ pass.Name, pass.CpuMs, -1.0 });
+			}
+			_lastFrame = frame.Stats;
+			return;
+		}
+	}
+
+	double nowUs = MicrosecondsSinceEpoch(Clock::now());
+	bool valid = true;
+	for (const PendingPass& pass : frame.Passes)
+	{
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(pass.Query, GL_QUERY_RESULT, &nanoseconds);
+		double gpuMs = (double)nanoseconds / 1e6;
+		// Some drivers (llvmpipe) report garbage for a pass with no draws in it. The GPU can't have
+		// spent longer on a pass than has passed since it was submitted
+		if (gpuMs * 1000.0 > nowUs - pass.StartUs)
+		{
+			valid = false;
+			frame.Stats.Passes.push_back({ pass.Name, pass.CpuMs, -1.0 });
+			continue;
+		}
+		frame.Stats.GpuMs += gpuMs;
+		frame.Stats.Passes.push_back({ pass.Name, pass.CpuMs, gpuMs });
+		// The query only gives a duration, it is drawn starting where the CPU submitted it
+		Record({ pass.Name, 'X', GpuTraceThread, pass.StartUs, gpuMs * 1000.0, 0.0 });
+	}
+	if (!valid)
+	{
+		_droppedGpuFrames++;
+		frame.Stats.GpuMs = -1.0;
+	}
+	_lastFrame = frame.Stats;
+}
+
+/// <summary>
+/// Deletes the query objects, call while the GL context is still current
+/// </summary>
+void Profiler::Release()
+{
+	for (QueryFrame& frame : _queryFrames)
+	{
+		if (!frame.QueryPool.empty())
+		{
+			glDeleteQueries((GLsizei)frame.QueryPool.size(), frame.QueryPool.data());
+		}
+		frame.QueryPool.clear();
+		frame.Passes.clear();
+		frame.Pending = false;
+	}
+}
+
+const ProfilerFrameStats& Profiler::LastFrame() const
+{
+	return _lastFrame;
+}
+
+unsigned long long Profiler::ResolvedFrames() const
+{
+	return _resolvedFrames;
+}
+
+unsigned long long Profiler::DroppedGpuFrames() const
+{
+	return _droppedGpuFrames;
+}
+
+#pragma endregion Frames
+
+#pragma region Zones
+
+void Profiler::BeginZone(const char* name)
+{
+	ZoneStack().push_back({ name, Clock::now() });
+}
+
+void Profiler::EndZone()
+{
+	std::vector<OpenZone>& stack = ZoneStack();
+	if (stack.empty())
+	{
+		return;
+	}
+	OpenZone zone = stack.back();
+	stack.pop_back();
+	double startUs = MicrosecondsSinceEpoch(zone.Start);
+	Record({ zone.Name, 'X', 0, startUs, MicrosecondsSinceEpoch(Clock::now()) - startUs, 0.0 });
+}
+
+void Profiler::BeginGpuPass(const char* name)
+{
+	BeginZone(name);
+	if (_gpuPassDepth++ > 0 || !_inFrame)
+	{
+		// Nested or outside a frame, only the CPU side is timed
+		return;
+	}
+	_gpuQueryActive = true;
+	_gpuPassStart = Clock::now();
+
+	QueryFrame& frame = _queryFrames[_frame % ProfilerQueryFrames];
+	if (frame.Passes.size() == frame.QueryPool.size())
+	{
+		GLuint query = 0;
+		glGenQueries(1, &query);
+		frame.QueryPool.push_back(query);
+	}
+	PendingPass pass;
+	pass.Name = name;
+	pass.Query = frame.QueryPool[frame.Passes.size()];
+	pass.StartUs = MicrosecondsSinceEpoch(_gpuPassStart);
+	pass.CpuMs = 0.0;
+	frame.Passes.push_back(pass);
+	glBeginQuery(GL_TIME_ELAPSED, pass.Query);
+}
+
+void Profiler::EndGpuPass()
+{
+	if (_gpuPassDepth > 0 && --_gpuPassDepth == 0 && _gpuQueryActive)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		QueryFrame& frame = _queryFrames[_frame % ProfilerQueryFrames];
+		frame.Passes.back().CpuMs = std::chrono::duration<double, std::milli>(Clock::now() - _gpuPassStart).count();
+		_gpuQueryActive = false;
+	}
+	EndZone();
+}
+
+void Profiler::CountDrawCalls(unsigned int count)
+{
+	_drawCalls += count;
+}
+
+void Profiler::CountUploadBytes(size_t bytes)
+{
+	_uploadBytes += bytes;
+}
+
+#pragma endregion Zones
+
+#pragma region Trace Export
+
+/// <summary>
+/// Starts or stops keeping events for WriteChromeTrace. Starting clears the previous capture.
+/// Call it from the GL thread, which is then listed as Main in the trace
+/// </summary>
+void Profiler::SetTraceCapture(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(_traceMutex);
+	if (enabled && !_capturing)
+	{
+		_events.clear();
+		ThreadIndex();
+	}
+	_capturing = enabled;
+}
+
+/// <summary>
+/// Writes the captured events in the Chrome trace event format, open it in chrome://tracing or ui.perfetto.dev
+/// </summary>
+/// <returns> false if the file could not be written </returns>
+bool Profiler::WriteChromeTrace(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "ERROR::PROFILER::TRACE_WRITE_FAILED " << path << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(_traceMutex);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << GpuTraceThread << ",\"args\":{\"name\":\"GPU\"}}";
+	for (const auto& thread : _threadIndices)
+	{
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread.second
+			<< ",\"args\":{\"name\":\"" << (thread.second == 0 ? "Main" : "Worker " + std::to_string(thread.second)) << "\"}}";
+	}
+	for (const TraceEvent& event : _events)
+	{
+		file << ",\n{\"name\":\"" << event.Name << "\",\"ph\":\"" << event.Phase << "\",\"pid\":0,\"tid\":" << event.Thread
+			<< ",\"ts\":" << event.StartUs;
+		if (event.Phase == 'X')
+		{
+			file << ",\"dur\":" << event.DurationUs << "}";
+		}
+		else
+		{
+			file << ",\"args\":{\"value\":" << event.Value << "}}";
+		}
+	}
+	file << "\n]}\n";
+	return (bool)file;
+}
+
+#pragma endregion Trace Export
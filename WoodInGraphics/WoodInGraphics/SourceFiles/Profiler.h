@@ -0,0 +1,172 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Frame instrumentation. CPU zones can be opened on any thread and nest, GPU passes wrap a
+/// GL_TIME_ELAPSED query and also time the CPU side. Queries are read back a couple of frames later once the GPU
+/// is done with them, so collecting results never stalls. Per frame draw calls and uploaded bytes are counted
+/// by whoever issues them, and everything can be captured and written out as a Chrome trace (chrome://tracing).
+/// -----------------
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#pragma region Includes
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#pragma endregion Includes
+
+// Query sets in flight. Results for a frame are read this many frames minus one later
+const unsigned int ProfilerQueryFrames = 3;
+
+struct ProfilerPassStats
+{
+	const char* Name = "";
+	double CpuMs = 0.0;
+	// Negative when the GPU result was not ready in time and got dropped
+	double GpuMs = -1.0;
+};
+
+struct ProfilerFrameStats
+{
+	unsigned long long Frame = 0;
+	double CpuMs = 0.0;
+	double GpuMs = 0.0;
+	unsigned int DrawCalls = 0;
+	size_t UploadBytes = 0;
+	std::vector<ProfilerPassStats> Passes;
+};
+
+class Profiler
+{
+public:
+
+	static Profiler& Instance();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// GL thread only
+	void BeginFrame();
+	void EndFrame();
+	void Release();
+
+	// Names must outlive the profiler, string literals are the intended use
+	void BeginZone(const char* name);
+	void EndZone();
+
+	// GL thread only and not nested, only one GL_TIME_ELAPSED query can be active at a time
+	void BeginGpuPass(const char* name);
+	void EndGpuPass();
+
+	// Thread safe
+	void CountDrawCalls(unsigned int count = 1);
+	void CountUploadBytes(size_t bytes);
+
+	// Most recent frame with its GPU results in, ResolvedFrames goes up by one every time it changes
+	const ProfilerFrameStats& LastFrame() const;
+	unsigned long long ResolvedFrames() const;
+	unsigned long long DroppedGpuFrames() const;
+
+	void SetTraceCapture(bool enabled);
+	bool WriteChromeTrace(const std::string& path) const;
+
+private:
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct OpenZone
+	{
+		const char* Name;
+		Clock::time_point Start;
+	};
+
+	struct TraceEvent
+	{
+		const char* Name;
+		// 'X' complete event or 'C' counter
+		char Phase;
+		unsigned int Thread;
+		double StartUs;
+		double DurationUs;
+		double Value;
+	};
+
+	struct PendingPass
+	{
+		const char* Name;
+		unsigned int Query;
+		double StartUs;
+		double CpuMs;
+	};
+
+	struct QueryFrame
+	{
+		ProfilerFrameStats Stats;
+		std::vector<PendingPass> Passes;
+		std::vector<unsigned int> QueryPool;
+		bool Pending = false;
+	};
+
+	Profiler();
+
+	Clock::time_point _epoch;
+	Clock::time_point _frameStart;
+	unsigned long long _frame = 0;
+	bool _inFrame = false;
+
+	std::atomic<unsigned int> _drawCalls{ 0 };
+	std::atomic<size_t> _uploadBytes{ 0 };
+
+	QueryFrame _queryFrames[ProfilerQueryFrames];
+	// Passes opened inside another pass only time the CPU side
+	unsigned int _gpuPassDepth = 0;
+	bool _gpuQueryActive = false;
+	Clock::time_point _gpuPassStart;
+	ProfilerFrameStats _lastFrame;
+	unsigned long long _resolvedFrames = 0;
+	unsigned long long _droppedGpuFrames = 0;
+
+	// Trace capture, shared with every thread that opens zones
+	mutable std::mutex _traceMutex;
+	bool _capturing = false;
+	std::vector<TraceEvent> _events;
+	std::unordered_map<size_t, unsigned int> _threadIndices;
+
+	// Each thread keeps its own stack of open zones
+	static std::vector<OpenZone>& ZoneStack();
+
+	double MicrosecondsSinceEpoch(Clock::time_point time) const;
+	unsigned int ThreadIndex();
+	void Record(const TraceEvent& event);
+	void ResolveQueries(QueryFrame& frame);
+};
+
+// Times the enclosing scope as a CPU zone
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char* name) { Profiler::Instance().BeginZone(name); }
+	~ProfileZone() { Profiler::Instance().EndZone(); }
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+// Times the enclosing scope on both the CPU and the GPU
+class GpuProfilePass
+{
+public:
+	explicit GpuProfilePass(const char* name) { Profiler::Instance().BeginGpuPass(name); }
+	~GpuProfilePass() { Profiler::Instance().EndGpuPass(); }
+
+	GpuProfilePass(const GpuProfilePass&) = delete;
+	GpuProfilePass& operator=(const GpuProfilePass&) = delete;
+};
+
+#endif // !PROFILER_H
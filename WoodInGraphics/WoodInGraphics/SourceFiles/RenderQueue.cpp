@@ -0,0 +1,202 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Sort key draw queue
+/// -----------------
+#include <glad/glad.h>
+
+#include <cstring>
+
+#include "GLStateCache.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+
+const unsigned int SortKeyDepthBits = 24;
+const uint64_t SortKeyTranslucentBit = 1ull << 59;
+
+/// <summary>
+/// Packs the draw's state into a key, sorting by it groups draws by state and orders them by depth
+/// </summary>
+/// <param name="layer"> 0-15, lower layers draw first </param>
+/// <param name="translucent"> drawn after the opaque draws of its layer, back to front with blending </param>
+/// <param name="program"> program id, only the low 12 bits are used </param>
+/// <param name="material"> caller's id for the textures and uniforms, only the low 16 bits are used </param>
+/// <param name="depth"> 0 nearest, 1 furthest </param>
+uint64_t RenderQueue::MakeSortKey(unsigned int layer, bool translucent, unsigned int program, unsigned int material, float depth)
+{
+	depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+	const uint64_t maxDepth = (1ull << SortKeyDepthBits) - 1;
+	uint64_t depthBits = (uint64_t)(depth * (float)maxDepth);
+	uint64_t state = ((uint64_t)(program & 0xFFF) << 16) | (uint64_t)(material & 0xFFFF);
+
+	uint64_t key = (uint64_t)(layer & 0xF) << 60;
+	if (translucent)
+	{
+		key |= SortKeyTranslucentBit;
+		key |= (maxDepth - depthBits) << 35;
+		key |= state << 7;
+	}
+	else
+	{
+		key |= state << 31;
+		key |= depthBits << 7;
+	}
+	return key;
+}
+
+bool RenderQueue::IsTranslucent(uint64_t key)
+{
+	return (key & SortKeyTranslucentBit) != 0;
+}
+
+void RenderQueue::Submit(uint64_t key, const DrawPacket& packet)
+{
+	_entries.push_back({ key, (uint32_t)_packets.size() });
+	_packets.push_back(packet);
+	_sorted = false;
+}
+
+void RenderQueue::Flush()
+{
+	Sort();
+	Execute();
+	Clear();
+}
+
+/// <summary>
+/// LSD radix sort on the keys, a byte per pass. Stable, so equal keys keep submission order.
+/// Passes where every key has the same byte (the unused low bits, a single layer) are skipped
+/// </summary>
+void RenderQueue::Sort()
+{
+	if (_sorted)
+	{
+		return;
+	}
+	_sorted = true;
+	size_t count = _entries.size();
+	if (count < 2)
+	{
+		return;
+	}
+
+	// All eight histograms in one pass over the keys
+	uint32_t histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (const SortEntry& entry : _entries)
+	{
+		for (unsigned int pass = 0; pass < 8; pass++)
+		{
+			histograms[pass][(entry.Key >> (pass * 8)) & 0xFF]++;
+		}
+	}
+
+	_scratch.resize(count);
+	SortEntry* source = _entries.data();
+	SortEntry* destination = _scratch.data();
+	for (unsigned int pass = 0; pass < 8; pass++)
+	{
+		uint32_t* histogram = histograms[pass];
+		unsigned int shift = pass * 8;
+		if (histogram[(source[0].Key >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+		// Counts to starting offsets
+		uint32_t offset = 0;
+		for (unsigned int digit = 0; digit < 256; digit++)
+		{
+			uint32_t digitCount = histogram[digit];
+			histogram[digit] = offset;
+			offset += digitCount;
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			destination[histogram[(source[i].Key >> shift) & 0xFF]++] = source[i];
+		}
+		SortEntry* swap = source;
+		source = destination;
+		destination = swap;
+	}
+	if (source != _entries.data())
+	{
+		_entries.swap(_scratch);
+	}
+}
+
+/// <summary>
+/// Replays the packets in key order. Every bind goes through the state cache, so only real changes reach GL
+/// </summary>
+void RenderQueue::Execute()
+{
+	if (!_sorted)
+	{
+		Sort();
+	}
+	GLStateCache& state = GLStateCache::Instance();
+	for (const SortEntry& entry : _entries)
+	{
+		const DrawPacket& packet = _packets[entry.Packet];
+		if (IsTranslucent(entry.Key))
+		{
+			state.SetCapability(GL_BLEND, true);
+			state.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			state.DepthMask(false);
+		}
+		else
+		{
+			state.SetCapability(GL_BLEND, false);
+			state.DepthMask(true);
+		}
+
+		state.UseProgram(packet.Program);
+		state.BindVertexArray(packet.VertexArray);
+		for (unsigned int unit = 0; unit < packet.TextureCount && unit < RenderQueueMaxTextures; unit++)
+		{
+			state.BindTexture(unit, packet.TextureTargets[unit], packet.Textures[unit]);
+		}
+		for (unsigned int i = 0; i < packet.UniformCount && i < RenderQueueMaxUniforms; i++)
+		{
+			const PacketUniform& uniform = packet.Uniforms[i];
+			if (uniform.Integer)
+			{
+				state.Uniform1i(uniform.Location, uniform.Int);
+			}
+			else
+			{
+				state.Uniform1f(uniform.Location, uniform.Float);
+			}
+		}
+		for (unsigned int i = 0; i < packet.UniformBlockCount && i < RenderQueueMaxUniformBlocks; i++)
+		{
+			const PacketUniformBlock& block = packet.UniformBlocks[i];
+			state.BindBufferRange(GL_UNIFORM_BUFFER, block.Binding, block.Buffer, block.Offset, block.Size);
+		}
+
+		if (packet.InstanceCount > 1)
+		{
+			glDrawElementsInstancedBaseVertex(packet.Mode, (GLsizei)packet.IndexCount, packet.IndexType, (const void*)packet.IndexOffset,
+				(GLsizei)packet.InstanceCount, packet.BaseVertex);
+		}
+		else if (packet.BaseVertex != 0)
+		{
+			glDrawElementsBaseVertex(packet.Mode, (GLsizei)packet.IndexCount, packet.IndexType, (const void*)packet.IndexOffset, packet.BaseVertex);
+		}
+		else
+		{
+			glDrawElements(packet.Mode, (GLsizei)packet.IndexCount, packet.IndexType, (const void*)packet.IndexOffset);
+		}
+	}
+	Profiler::Instance().CountDrawCalls((unsigned int)_entries.size());
+}
+
+void RenderQueue::Clear()
+{
+	_packets.clear();
+	_entries.clear();
+	_sorted = false;
+}
+
+size_t RenderQueue::Size() const
+{
+	return _entries.size();
+}
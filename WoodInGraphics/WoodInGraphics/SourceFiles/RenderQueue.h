@@ -0,0 +1,105 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Collects a frame's draws as packets tagged with a 64 bit sort key, radix sorts them and replays
+/// them through the GL state cache. Draws that share a program, vertex array or textures end up next to each other,
+/// so the state only changes where the sorted order actually changes it.
+/// Key layout, most significant first:
+///   opaque:      layer 4 | translucent 0 | program 12 | material 16 | depth 24 (front to back) | unused 7
+///   translucent: layer 4 | translucent 1 | depth 24 (back to front) | program 12 | material 16 | unused 7
+/// Translucent draws have to be ordered by depth for blending to be right, so depth moves above the state bits.
+/// -----------------
+
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#pragma endregion Includes
+
+const unsigned int RenderQueueMaxTextures = 4;
+const unsigned int RenderQueueMaxUniforms = 4;
+const unsigned int RenderQueueMaxUniformBlocks = 2;
+
+struct PacketUniform
+{
+	// -1 is skipped, same as glUniform
+	int Location = -1;
+	bool Integer = false;
+	float Float = 0.0f;
+	int Int = 0;
+};
+
+// Range of a buffer bound to a uniform block binding point, see UniformBlock.h
+struct PacketUniformBlock
+{
+	unsigned int Binding = 0;
+	unsigned int Buffer = 0;
+	size_t Offset = 0;
+	size_t Size = 0;
+};
+
+struct DrawPacket
+{
+	unsigned int Program = 0;
+	unsigned int VertexArray = 0;
+	// Texture name per unit, units past TextureCount are left alone
+	unsigned int Textures[RenderQueueMaxTextures] = {};
+	// GL_TEXTURE_2D unless set, TextureManager::GetTextureTarget says which
+	unsigned int TextureTargets[RenderQueueMaxTextures] = { 0x0DE1, 0x0DE1, 0x0DE1, 0x0DE1 };
+	unsigned int TextureCount = 0;
+	PacketUniform Uniforms[RenderQueueMaxUniforms];
+	unsigned int UniformCount = 0;
+	PacketUniformBlock UniformBlocks[RenderQueueMaxUniformBlocks];
+	unsigned int UniformBlockCount = 0;
+	// GL_TRIANGLES
+	unsigned int Mode = 0x0004;
+	// GL_UNSIGNED_INT
+	unsigned int IndexType = 0x1405;
+	unsigned int IndexCount = 0;
+	// Byte offset into the vertex array's element buffer
+	size_t IndexOffset = 0;
+	// Added to every index, lets 16 bit indices reach past vertex 65535 (see IndexBuffer.h)
+	int BaseVertex = 0;
+	// More than one draws with glDrawElementsInstanced, see InstancedMesh
+	unsigned int InstanceCount = 1;
+};
+
+class RenderQueue
+{
+public:
+
+	// Depth is view distance mapped to [0, 1], anything outside is clamped
+	static uint64_t MakeSortKey(unsigned int layer, bool translucent, unsigned int program, unsigned int material, float depth);
+	static bool IsTranslucent(uint64_t key);
+
+	void Submit(uint64_t key, const DrawPacket& packet);
+
+	// Sorts, replays on the GL thread and empties the queue
+	void Flush();
+	void Sort();
+	void Execute();
+	void Clear();
+
+	size_t Size() const;
+
+private:
+
+	struct SortEntry
+	{
+		uint64_t Key;
+		uint32_t Packet;
+	};
+
+	// Kept between frames so a steady scene never allocates
+	std::vector<DrawPacket> _packets;
+	std::vector<SortEntry> _entries;
+	std::vector<SortEntry> _scratch;
+	bool _sorted = false;
+};
+
+#endif // !RENDER_QUEUE_H
@@ -0,0 +1,478 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Shader reading, compiling, linking, binary caching and uniform reflection
+/// -----------------
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "GLStateCache.h"
+#include "Shader.h"
+#include "ShaderPreprocessor.h"
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines)
+{
+	// Retrieve vertex/fragment source code from file paths
+	std::string vertexCode;
+	std::string fragmentCode;
+	ReadShaderFiles(vertexPath, fragmentPath, defines, vertexCode, fragmentCode, &_sourceFiles);
+
+	// Try the binary cache first, only fall back to compiling when there is no usable binary
+	bool useBinaryCache = BinaryCacheAvailable();
+	unsigned long long cacheKey = useBinaryCache ? BinaryCacheKey(vertexCode, fragmentCode, defines) : 0;
+	if (useBinaryCache && LoadProgramBinary(cacheKey))
+	{
+		ReflectUniforms();
+		return;
+	}
+
+	CompileAndLink(vertexCode.c_str(), fragmentCode.c_str(), useBinaryCache);
+	if (useBinaryCache)
+	{
+		SaveProgramBinary(cacheKey);
+	}
+
+	ReflectUniforms();
+}
+
+/// <summary>
+/// Reads both shader source files from disk with their includes resolved and the defines injected
+/// </summary>
+/// <param name="files"> optional, gets every file either stage read, each once </param>
+/// <returns> false if either file could not be read </returns>
+bool Shader::ReadShaderFiles(const char* vertexPath, const char* fragmentPath, const std::string& defines, std::string& vertexCode,
+	std::string& fragmentCode, std::vector<std::string>* files)
+{
+	std::vector<std::string> vertexFiles;
+	std::vector<std::string> fragmentFiles;
+	bool vertexRead = PreprocessShader(vertexPath, defines, vertexCode, &vertexFiles);
+	bool fragmentRead = PreprocessShader(fragmentPath, defines, fragmentCode, &fragmentFiles);
+	if (files)
+	{
+		*files = vertexFiles;
+		for (const std::string& file : fragmentFiles)
+		{
+			if (std::find(files->begin(), files->end(), file) == files->end())
+			{
+				files->push_back(file);
+			}
+		}
+	}
+	return vertexRead && fragmentRead;
+}
+
+/// <summary>
+/// Compiles both shader stages and links them into ID
+/// </summary>
+/// <param name="vShaderCode"> vertex shader source </param>
+/// <param name="fShaderCode"> fragment shader source </param>
+/// <param name="retrievable"> hint to the driver that we will read the binary back with glGetProgramBinary </param>
+void Shader::CompileAndLink(const char* vShaderCode, const char* fShaderCode, bool retrievable)
+{
+	// Compile Shaders
+	// ---- Vertex Shader ----
+	// Create shader object
+	// Attach out shader to shader object
+	// Compile the shader
+	unsigned int vertexShader, fragmentShader;
+	int success;
+	char infoLog[512];
+
+	vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &vShaderCode, NULL);
+	glCompileShader(vertexShader);
+	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+	}
+
+	// ---- Fragment Shader ----
+	// Create shader object
+	// Attach out shader to shader object
+	// Compile the shader
+	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
+	glCompileShader(fragmentShader);
+	// Check if shader compiled successfully
+	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+	}
+
+	// Bind Shader to Shader object
+	// *Warning* Linker errors can occur if typo in shaders, since we link them (glLinkProgram)
+	ID = glCreateProgram();
+	glAttachShader(ID, vertexShader);
+	glAttachShader(ID, fragmentShader);
+	if (retrievable)
+	{
+		glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(ID);
+	glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(ID, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::LINKING_FAILED\n" << infoLog << std::endl;
+	}
+	// Delete Shaders after linking, no longer needed
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+}
+
+/// <summary>
+/// True when the driver can hand back program binaries and the cache is turned on
+/// </summary>
+bool Shader::BinaryCacheAvailable()
+{
+	if (!GLAD_GL_ARB_get_program_binary || BinaryCacheDirectory().empty())
+	{
+		return false;
+	}
+	int formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	return formatCount > 0;
+}
+
+/// <summary>
+/// Folder the program binaries are written to, relative to the working directory
+/// </summary>
+std::string& Shader::BinaryCacheDirectory()
+{
+	static std::string directory = "ShaderCache";
+	return directory;
+}
+
+/// <summary>
+/// 64 bit FNV-1a over everything that makes a binary invalid: the sources, the defines and the driver
+/// </summary>
+unsigned long long Shader::BinaryCacheKey(const std::string& vertexCode, const std::string& fragmentCode, const std::string& defines) const
+{
+	unsigned long long hash = 14695981039346656037ull;
+	auto hashString = [&hash](const char* text)
+	{
+		// Include the terminator so "ab"+"c" and "a"+"bc" hash differently
+		for (const char* c = text ? text : ""; ; c++)
+		{
+			hash = (hash ^ (unsigned long long)(unsigned char)*c) * 1099511628211ull;
+			if (*c == '\0')
+			{
+				break;
+			}
+		}
+	};
+	hashString((const char*)glGetString(GL_VENDOR));
+	hashString((const char*)glGetString(GL_RENDERER));
+	hashString((const char*)glGetString(GL_VERSION));
+	hashString(defines.c_str());
+	hashString(vertexCode.c_str());
+	hashString(fragmentCode.c_str());
+	return hash;
+}
+
+/// <summary>
+/// Path of the cache file for a key
+/// </summary>
+static std::filesystem::path ShaderBinaryPath(unsigned long long key)
+{
+	char fileName[32];
+	snprintf(fileName, sizeof(fileName), "%016llx.bin", key);
+	return std::filesystem::path(Shader::BinaryCacheDirectory()) / fileName;
+}
+
+/// <summary>
+/// Loads a cached program binary into a new program
+/// </summary>
+/// <returns> true if the driver accepted the binary, false means the caller has to compile from source </returns>
+bool Shader::LoadProgramBinary(unsigned long long key)
+{
+	std::ifstream file(ShaderBinaryPath(key), std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	// File layout: binary format (GLenum) followed by the binary blob
+	std::streamsize fileSize = file.tellg();
+	if (fileSize <= (std::streamsize)sizeof(GLenum))
+	{
+		return false;
+	}
+	file.seekg(0);
+	GLenum format = 0;
+	std::vector<char> binary((size_t)fileSize - sizeof(GLenum));
+	file.read((char*)&format, sizeof(format));
+	file.read(binary.data(), (std::streamsize)binary.size());
+	if (!file)
+	{
+		return false;
+	}
+
+	ID = glCreateProgram();
+	glProgramBinary(ID, format, binary.data(), (GLsizei)binary.size());
+	int success = 0;
+	glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		// Driver update or different GPU, drop the stale file and rebuild it from source
+		std::cout << "Shader binary rejected, recompiling" << std::endl;
+		GLStateCache::Instance().DeleteProgram(ID);
+		ID = 0;
+		std::error_code error;
+		std::filesystem::remove(ShaderBinaryPath(key), error);
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Writes the linked program binary to the cache folder
+/// </summary>
+void Shader::SaveProgramBinary(unsigned long long key) const
+{
+	int success = 0;
+	int length = 0;
+	glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (!success || length <= 0)
+	{
+		return;
+	}
+
+	GLenum format = 0;
+	std::vector<char> binary((size_t)length);
+	glGetProgramBinary(ID, length, &length, &format, binary.data());
+
+	std::error_code error;
+	std::filesystem::create_directories(BinaryCacheDirectory(), error);
+	std::ofstream file(ShaderBinaryPath(key), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::SHADER::BINARY_CACHE_NOT_WRITABLE" << std::endl;
+		return;
+	}
+	file.write((const char*)&format, sizeof(format));
+	file.write(binary.data(), length);
+}
+
+/// <summary>
+/// Queries every active uniform once after linking and stores its location in a flat hash table,
+/// so setting a uniform never has to go back to the driver with glGetUniformLocation
+/// </summary>
+void Shader::ReflectUniforms()
+{
+	int uniformCount = 0;
+	int maxNameLength = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	// Keep the table at most half full so probes stay short
+	size_t tableSize = 8;
+	while (tableSize < (size_t)uniformCount * 2)
+	{
+		tableSize *= 2;
+	}
+	_uniforms.assign(tableSize, UniformSlot());
+
+	std::vector<char> nameBuffer((size_t)std::max(maxNameLength, 1));
+	for (int i = 0; i < uniformCount; i++)
+	{
+		int nameLength = 0;
+		int size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &nameLength, &size, &type, nameBuffer.data());
+
+		std::string name(nameBuffer.data(), (size_t)nameLength);
+		int location = glGetUniformLocation(ID, name.c_str());
+		// Uniforms inside a uniform block have no location
+		if (location == -1)
+		{
+			continue;
+		}
+		// Arrays are reported as "name[0]", register the plain name as well since that is what the GLSL code uses
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+		{
+			name.resize(name.size() - 3);
+		}
+
+		unsigned int hash = HashUniformName(name.c_str());
+		size_t mask = _uniforms.size() - 1;
+		size_t index = hash & mask;
+		bool collision = false;
+		while (_uniforms[index].Location != -1)
+		{
+			if (_uniforms[index].Hash == hash)
+			{
+				collision = true;
+				break;
+			}
+			index = (index + 1) & mask;
+		}
+		// Handles only carry the hash so the two names can't be told apart, the first one keeps its slot and this
+		// one is left out (it reads as -1) rather than silently taking over the other's location
+		if (collision)
+		{
+			std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION\n" << name << " is not reachable, rename it" << std::endl;
+			continue;
+		}
+		_uniforms[index].Hash = hash;
+		_uniforms[index].Location = location;
+	}
+
+	// Uniform blocks, by name with the size the program expects
+	int blockCount = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+	_uniformBlocks.clear();
+	nameBuffer.resize((size_t)std::max(maxNameLength, 1));
+	for (int i = 0; i < blockCount; i++)
+	{
+		int nameLength = 0;
+		glGetActiveUniformBlockName(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &nameLength, nameBuffer.data());
+		UniformBlockInfo block;
+		block.Hash = HashUniformName(std::string(nameBuffer.data(), (size_t)nameLength).c_str());
+		block.Index = (unsigned int)i;
+		glGetActiveUniformBlockiv(ID, (GLuint)i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.DataSize);
+		_uniformBlocks.push_back(block);
+	}
+}
+
+/// <summary>
+///  Use the Shader
+/// </summary>
+void Shader::UseShader()
+{
+	GLStateCache::Instance().UseProgram(ID);
+}
+
+/// <summary>
+/// Looks up a uniform location in the reflected table, no driver call
+/// </summary>
+/// <param name="handle"> hashed uniform name </param>
+/// <returns> location of the uniform or -1 if the program does not use it (glUniform ignores -1) </returns>
+int Shader::GetUniformLocation(UniformHandle handle) const
+{
+	if (_uniforms.empty())
+	{
+		return -1;
+	}
+	size_t mask = _uniforms.size() - 1;
+	size_t index = handle.Hash & mask;
+	while (_uniforms[index].Location != -1)
+	{
+		if (_uniforms[index].Hash == handle.Hash)
+		{
+			return _uniforms[index].Location;
+		}
+		index = (index + 1) & mask;
+	}
+	return -1;
+}
+
+const std::vector<std::string>& Shader::GetSourceFiles() const
+{
+	return _sourceFiles;
+}
+
+/// <summary>
+/// Looks up a reflected uniform block
+/// </summary>
+/// <returns> the block's index in the program or -1 if it has none by that name </returns>
+int Shader::GetUniformBlockIndex(UniformHandle handle) const
+{
+	for (const UniformBlockInfo& block : _uniformBlocks)
+	{
+		if (block.Hash == handle.Hash)
+		{
+			return (int)block.Index;
+		}
+	}
+	return -1;
+}
+
+/// <summary>
+/// Bytes the program expects the block to have (GL_UNIFORM_BLOCK_DATA_SIZE), -1 if it has no such block
+/// </summary>
+int Shader::GetUniformBlockSize(UniformHandle handle) const
+{
+	for (const UniformBlockInfo& block : _uniformBlocks)
+	{
+		if (block.Hash == handle.Hash)
+		{
+			return block.DataSize;
+		}
+	}
+	return -1;
+}
+
+/// <summary>
+/// Assigns a uniform block to a binding point. Program state, so this is done once after linking
+/// </summary>
+/// <param name="handle"> hashed block name </param>
+/// <param name="binding"> binding point the buffer range will be bound to, see UniformBlock.h </param>
+/// <param name="expectedSize"> sizeof the C++ struct the block is written from, 0 skips the check </param>
+/// <returns> false if the program has no such block or it is bigger than the struct </returns>
+bool Shader::BindUniformBlock(UniformHandle handle, unsigned int binding, size_t expectedSize) const
+{
+	int index = GetUniformBlockIndex(handle);
+	if (index == -1)
+	{
+		return false;
+	}
+	// The static_asserts check the struct against std140, this catches the GLSL block and the struct disagreeing
+	if (expectedSize != 0 && (size_t)GetUniformBlockSize(handle) > expectedSize)
+	{
+		std::cout << "ERROR::SHADER::UNIFORM_BLOCK_SIZE_MISMATCH " << GetUniformBlockSize(handle) << " > " << expectedSize << std::endl;
+		return false;
+	}
+	glUniformBlockBinding(ID, (GLuint)index, binding);
+	return true;
+}
+
+/// <summary>
+/// Set bool uniform
+/// </summary>
+/// <param name="name"></param>
+/// <param name="value"></param>
+void Shader::SetBool(const std::string& name, bool value) const
+{
+	SetBool(UniformHandle(name.c_str()), value);
+}
+
+void Shader::SetInt(const std::string& name, int value) const
+{
+	SetInt(UniformHandle(name.c_str()), value);
+}
+
+void Shader::SetFloat(const std::string& name, float value) const
+{
+	SetFloat(UniformHandle(name.c_str()), value);
+}
+
+/// <summary>
+/// Set bool uniform through a pre-hashed handle
+/// </summary>
+/// <param name="handle"></param>
+/// <param name="value"></param>
+void Shader::SetBool(UniformHandle handle, bool value) const
+{
+	GLStateCache::Instance().Uniform1i(GetUniformLocation(handle), (int)value);
+}
+
+void Shader::SetInt(UniformHandle handle, int value) const
+{
+	GLStateCache::Instance().Uniform1i(GetUniformLocation(handle), value);
+}
+
+void Shader::SetFloat(UniformHandle handle, float value) const
+{
+	GLStateCache::Instance().Uniform1f(GetUniformLocation(handle), value);
+}
@@ -1,8 +1,8 @@
 #pragma once
 /// ---- Summary ----
 /// Author: Kody Wood
-/// Description: Handles shader file reading fdrom disk, compiling, linking and checking errors
-/// Everything is done in the header file so it is portable
+/// Description: Handles shader file reading fdrom disk (through ShaderPreprocessor), compiling, linking and checking errors.
+/// The definitions live in Shader.cpp so includers don't pull in glad and the file stream headers
 /// -----------------
 
 #ifndef SHADER_H
@@ -10,150 +10,110 @@
 
 #pragma region Includes
 
-#include <glad/glad.h>
-
+#include <cstddef>
 #include <string>
-#include <fstream>
-#include <sstream>
-#include <iostream>
+#include <vector>
 
 #pragma endregion Includes
 
+#pragma region Uniform Handles
+
+/// <summary>
+/// FNV-1a hash of a uniform name, constexpr so handles for literal names are computed at compile time
+/// </summary>
+constexpr unsigned int HashUniformName(const char* name, unsigned int hash = 2166136261u)
+{
+	return (*name == '\0') ? hash : HashUniformName(name + 1, (hash ^ (unsigned int)(unsigned char)*name) * 16777619u);
+}
+
+/// <summary>
+/// Hashed uniform name. Make these once (ideally constexpr) and reuse them every frame
+/// </summary>
+struct UniformHandle
+{
+	unsigned int Hash;
+
+	constexpr explicit UniformHandle(const char* name) : Hash(HashUniformName(name)) {}
+};
+
+/// <summary>
+/// Lets you write "arrowAlpha"_uniform
+/// </summary>
+constexpr UniformHandle operator""_uniform(const char* name, size_t)
+{
+	return UniformHandle(name);
+}
+
+#pragma endregion Uniform Handles
+
 class Shader
 {
 public:
 
-	unsigned int ID;
+	unsigned int ID = 0;
 
-	Shader(const char* vertexPath, const char* fragmentPath);
+	Shader() = default;
+	// defines go after #version in both stages, see ShaderPreprocessor.h
+	Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines = "");
 
 	void UseShader();
 
+	// Folder for cached program binaries, empty string turns the cache off
+	static std::string& BinaryCacheDirectory();
+
+	int GetUniformLocation(UniformHandle handle) const;
+	// Every file the program was built from, includes too, for reloading it when one changes
+	const std::vector<std::string>& GetSourceFiles() const;
+
+	// Uniform blocks by name, -1 when the program has no such block
+	int GetUniformBlockIndex(UniformHandle handle) const;
+	int GetUniformBlockSize(UniformHandle handle) const;
+	// Points the block at a binding point, expectedSize is the C++ struct's size and is checked against the program's
+	bool BindUniformBlock(UniformHandle handle, unsigned int binding, size_t expectedSize = 0) const;
+
 	void SetBool(const std::string& name, bool value) const;
 	void SetInt(const std::string& name, int value) const;
 	void SetFloat(const std::string& name, float value) const;
 
-private:
-
-};
+	void SetBool(UniformHandle handle, bool value) const;
+	void SetInt(UniformHandle handle, int value) const;
+	void SetFloat(UniformHandle handle, float value) const;
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
-{
-	// Retrieve vertex/fragment source code from file paths
-	std::string vertexCode;
-	std::string fragmentCode;
-	std::ifstream vShaderFile;
-	std::ifstream fShaderFile;
+private:
 
-	//Flagged when: failbit - i.e get number instead of letter | badbit - serious error that disrupts stream
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+	// Builds Shaders from programs it compiled in the background
+	friend class ShaderCompiler;
 
-	try
-	{
-		// Open file
-		vShaderFile.open(vertexPath);
-		fShaderFile.open(fragmentPath);
-		std::stringstream vShaderStream, fShaderStream;
-
-		// Read file's buffer contexts into streams
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
-
-		// Close file handlers
-		vShaderFile.close();
-		fShaderFile.close();
-		
-		// Convert stream into string
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
-	}
-	catch (std::istream::failure e)
-	{
-		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
-	}
-
-	const char* vShaderCode = vertexCode.c_str();
-	const char* fShaderCode = fragmentCode.c_str();
-
-	// Compile Shaders
-	// ---- Vertex Shader ----
-	// Create shader object
-	// Attach out shader to shader object
-	// Compile the shader
-	unsigned int vertexShader, fragmentShader;
-	int success;
-	char infoLog[512];
-
-	vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vShaderCode, NULL);
-	glCompileShader(vertexShader);
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-	if (!success)
+	// One slot of the open addressed uniform table, Location is -1 when the slot is empty
+	struct UniformSlot
 	{
-		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-	}
-
-	// ---- Fragment Shader ----
-	// Create shader object
-	// Attach out shader to shader object
-	// Compile the shader
-	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
-	glCompileShader(fragmentShader);
-	// Check if shader compiled successfully
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-	}
-
-	// Bind Shader to Shader object
-	// *Warning* Linker errors can occur if typo in shaders, since we link them (glLinkProgram)
-	ID = glCreateProgram();
-	glAttachShader(ID, vertexShader);
-	glAttachShader(ID, fragmentShader);
-	glLinkProgram(ID);
-	glGetProgramiv(ID, GL_LINK_STATUS, &success);
-	if (!success)
-	{
-		glGetProgramInfoLog(ID, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::LINKING_FAILED\n" << infoLog << std::endl;
-	}
-	// Delete Shaders after linking, no longer needed
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
-
-}
-
-/// <summary>
-///  Use the Shader
-/// </summary>
-void Shader::UseShader()
-{
-	glUseProgram(ID);
-}
+		unsigned int Hash = 0;
+		int Location = -1;
+	};
 
-/// <summary>
-/// Set bool uniform
-/// </summary>
-/// <param name="name"></param>
-/// <param name="value"></param>
-void Shader::SetBool(const std::string& name, bool value) const
-{
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
-}
-
-void Shader::SetInt(const std::string& name, int value) const
-{
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
-}
-
-void Shader::SetFloat(const std::string& name, float value) const
-{
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
-}
+	struct UniformBlockInfo
+	{
+		unsigned int Hash = 0;
+		unsigned int Index = 0;
+		int DataSize = 0;
+	};
+
+	// Size is always a power of two so the hash can be masked instead of using modulo
+	std::vector<UniformSlot> _uniforms;
+	// A program has a handful of blocks at most, searched linearly
+	std::vector<UniformBlockInfo> _uniformBlocks;
+	std::vector<std::string> _sourceFiles;
+
+	void ReflectUniforms();
+
+	static bool ReadShaderFiles(const char* vertexPath, const char* fragmentPath, const std::string& defines, std::string& vertexCode,
+		std::string& fragmentCode, std::vector<std::string>* files = nullptr);
+	static bool BinaryCacheAvailable();
+
+	void CompileAndLink(const char* vShaderCode, const char* fShaderCode, bool retrievable);
+	unsigned long long BinaryCacheKey(const std::string& vertexCode, const std::string& fragmentCode, const std::string& defines) const;
+	bool LoadProgramBinary(unsigned long long key);
+	void SaveProgramBinary(unsigned long long key) const;
+};
 
 #endif // !SHADER_H
@@ -0,0 +1,251 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Deferred shader compilation. Submit issues the compile/link calls without asking for the result,
+/// Poll picks up finished programs and hands them to the futures returned by Submit.
+/// -----------------
+#include <glad/glad.h>
+
+#include <filesystem>
+#include <iostream>
+
+#include "GLStateCache.h"
+#include "ShaderCompiler.h"
+
+/// <summary>
+/// Milliseconds between two time points
+/// </summary>
+static double ElapsedMs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/// <summary>
+/// Needs a current GL context, checks whether the driver can compile in the background
+/// </summary>
+ShaderCompiler::ShaderCompiler()
+{
+	_parallel = GLAD_GL_KHR_parallel_shader_compile != 0;
+	if (_parallel)
+	{
+		// 0xFFFFFFFF lets the driver pick as many threads as it wants
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+	}
+}
+
+/// <summary>
+/// Finishes whatever is still pending so no future is left without a value
+/// </summary>
+ShaderCompiler::~ShaderCompiler()
+{
+	WaitAll();
+}
+
+/// <summary>
+/// Reads the sources and kicks off compile and link without waiting for either
+/// </summary>
+/// <param name="vertexPath"> path to the vertex shader </param>
+/// <param name="fragmentPath"> path to the fragment shader </param>
+/// <param name="defines"> #define lines for this variant, part of the binary cache key </param>
+/// <returns> future that gets the Shader once Poll sees it finish, ID is 0 if it failed </returns>
+std::future<Shader> ShaderCompiler::Submit(const char* vertexPath, const char* fragmentPath, const std::string& defines)
+{
+	PendingProgram program;
+	program.Name = std::filesystem::path(vertexPath).filename().string() + "/" + std::filesystem::path(fragmentPath).filename().string();
+	// Variants are told apart in the log by the names they define
+	for (size_t position = defines.find("#define "); position != std::string::npos; position = defines.find("#define ", position + 1))
+	{
+		size_t nameStart = position + 8;
+		program.Name += " +" + defines.substr(nameStart, defines.find_first_of(" \n", nameStart) - nameStart);
+	}
+	program.SubmitTime = std::chrono::steady_clock::now();
+	std::future<Shader> future = program.Result.get_future();
+
+	std::string vertexCode;
+	std::string fragmentCode;
+	Shader::ReadShaderFiles(vertexPath, fragmentPath, defines, vertexCode, fragmentCode, &program.SourceFiles);
+
+	// A cached binary is ready straight away, no need to queue it
+	program.SaveBinary = Shader::BinaryCacheAvailable();
+	if (program.SaveBinary)
+	{
+		program.CacheKey = Shader().BinaryCacheKey(vertexCode, fragmentCode, defines);
+		Shader shader;
+		if (shader.LoadProgramBinary(program.CacheKey))
+		{
+			shader._sourceFiles = program.SourceFiles;
+			shader.ReflectUniforms();
+			program.Result.set_value(shader);
+			std::cout << "Shader " << program.Name << ": binary cache "
+				<< ElapsedMs(program.SubmitTime, std::chrono::steady_clock::now()) << " ms" << std::endl;
+			return future;
+		}
+	}
+
+	const char* vShaderCode = vertexCode.c_str();
+	const char* fShaderCode = fragmentCode.c_str();
+
+	program.VertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(program.VertexShader, 1, &vShaderCode, NULL);
+	glCompileShader(program.VertexShader);
+
+	program.FragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(program.FragmentShader, 1, &fShaderCode, NULL);
+	glCompileShader(program.FragmentShader);
+
+	// Linking straight away is fine, the driver waits for the compiles itself
+	program.Program = glCreateProgram();
+	glAttachShader(program.Program, program.VertexShader);
+	glAttachShader(program.Program, program.FragmentShader);
+	if (program.SaveBinary)
+	{
+		glProgramParameteri(program.Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(program.Program);
+
+	program.SubmitMs = ElapsedMs(program.SubmitTime, std::chrono::steady_clock::now());
+	_pending.push_back(std::move(program));
+	return future;
+}
+
+/// <summary>
+/// Call once per frame on the GL thread. Resolves every finished program when the driver compiles in parallel,
+/// otherwise resolves one program per call so a long queue is spread over several frames
+/// </summary>
+void ShaderCompiler::Poll()
+{
+	for (size_t i = 0; i < _pending.size();)
+	{
+		if (IsComplete(_pending[i]))
+		{
+			Resolve(_pending[i]);
+			_pending.erase(_pending.begin() + i);
+			if (!_parallel)
+			{
+				return;
+			}
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+/// <summary>
+/// Blocks until every submitted program is resolved
+/// </summary>
+void ShaderCompiler::WaitAll()
+{
+	for (PendingProgram& program : _pending)
+	{
+		Resolve(program);
+	}
+	_pending.clear();
+}
+
+size_t ShaderCompiler::PendingCount() const
+{
+	return _pending.size();
+}
+
+bool ShaderCompiler::IsParallel() const
+{
+	return _parallel;
+}
+
+/// <summary>
+/// Non blocking completion check. Without the extension there is no way to ask, so it always says yes
+/// </summary>
+bool ShaderCompiler::IsComplete(PendingProgram& program)
+{
+	if (!_parallel)
+	{
+		return true;
+	}
+
+	if (!program.Compiled)
+	{
+		int vertexDone = 0;
+		int fragmentDone = 0;
+		glGetShaderiv(program.VertexShader, GL_COMPLETION_STATUS_KHR, &vertexDone);
+		glGetShaderiv(program.FragmentShader, GL_COMPLETION_STATUS_KHR, &fragmentDone);
+		if (!vertexDone || !fragmentDone)
+		{
+			return false;
+		}
+		program.Compiled = true;
+		program.CompiledTime = std::chrono::steady_clock::now();
+	}
+
+	int linkDone = 0;
+	glGetProgramiv(program.Program, GL_COMPLETION_STATUS_KHR, &linkDone);
+	return linkDone != 0;
+}
+
+/// <summary>
+/// Reads the compile/link status and logs, fills the future and prints the timings.
+/// Compile/link times are measured from submit when the driver compiles in parallel,
+/// otherwise they are the time spent blocked on the status query
+/// </summary>
+void ShaderCompiler::Resolve(PendingProgram& program)
+{
+	int success;
+	char infoLog[512];
+	bool failed = false;
+
+	auto compileStart = std::chrono::steady_clock::now();
+	glGetShaderiv(program.VertexShader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		glGetShaderInfoLog(program.VertexShader, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+		failed = true;
+	}
+	glGetShaderiv(program.FragmentShader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		glGetShaderInfoLog(program.FragmentShader, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+		failed = true;
+	}
+	auto compileEnd = std::chrono::steady_clock::now();
+
+	glGetProgramiv(program.Program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(program.Program, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::LINKING_FAILED\n" << infoLog << std::endl;
+		failed = true;
+	}
+	auto linkEnd = std::chrono::steady_clock::now();
+
+	glDeleteShader(program.VertexShader);
+	glDeleteShader(program.FragmentShader);
+
+	double compileMs = ElapsedMs(compileStart, compileEnd);
+	double linkMs = ElapsedMs(compileEnd, linkEnd);
+	if (program.Compiled)
+	{
+		compileMs = ElapsedMs(program.SubmitTime, program.CompiledTime);
+		linkMs = ElapsedMs(program.CompiledTime, linkEnd);
+	}
+	std::cout << "Shader " << program.Name << ": submit " << program.SubmitMs << " ms | compile "
+		<< compileMs << " ms | link " << linkMs << " ms" << std::endl;
+
+	Shader shader;
+	shader._sourceFiles = program.SourceFiles;
+	if (failed)
+	{
+		GLStateCache::Instance().DeleteProgram(program.Program);
+		program.Result.set_value(shader);
+		return;
+	}
+
+	shader.ID = program.Program;
+	if (program.SaveBinary)
+	{
+		shader.SaveProgramBinary(program.CacheKey);
+	}
+	shader.ReflectUniforms();
+	program.Result.set_value(shader);
+}
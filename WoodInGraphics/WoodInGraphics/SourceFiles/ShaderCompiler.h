@@ -0,0 +1,69 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Compiles shader programs in the background. Every program is submitted up front and the
+/// status checks are deferred, so the main loop can keep presenting frames while the driver works.
+/// Uses GL_KHR_parallel_shader_compile when the driver has it, otherwise resolves one program per Poll.
+/// -----------------
+
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#pragma region Includes
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "Shader.h"
+
+#pragma endregion Includes
+
+class ShaderCompiler
+{
+public:
+
+	ShaderCompiler();
+	~ShaderCompiler();
+
+	// defines go after #version in both stages, see ShaderPreprocessor.h
+	std::future<Shader> Submit(const char* vertexPath, const char* fragmentPath, const std::string& defines = "");
+
+	void Poll();
+	void WaitAll();
+
+	size_t PendingCount() const;
+	bool IsParallel() const;
+
+private:
+
+	struct PendingProgram
+	{
+		std::string Name;
+		std::promise<Shader> Result;
+		// Handed to the Shader whether it builds or not, so a broken shader can still be reloaded
+		std::vector<std::string> SourceFiles;
+
+		unsigned int VertexShader = 0;
+		unsigned int FragmentShader = 0;
+		unsigned int Program = 0;
+
+		bool SaveBinary = false;
+		unsigned long long CacheKey = 0;
+
+		// Timings for the report, compile/link are measured from when the driver said it was done
+		std::chrono::steady_clock::time_point SubmitTime;
+		std::chrono::steady_clock::time_point CompiledTime;
+		bool Compiled = false;
+		double SubmitMs = 0.0;
+	};
+
+	std::vector<PendingProgram> _pending;
+	bool _parallel = false;
+
+	bool IsComplete(PendingProgram& program);
+	void Resolve(PendingProgram& program);
+};
+
+#endif // !SHADER_COMPILER_H
@@ -0,0 +1,160 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: #include and #define handling for shader sources
+/// -----------------
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "ShaderPreprocessor.h"
+
+// Deeper than this is an include cycle
+const unsigned int ShaderMaxIncludeDepth = 32;
+
+struct ShaderPreprocessState
+{
+	std::vector<std::string> Files;
+	std::string Defines;
+	std::string Output;
+};
+
+static bool ReadTextFile(const std::string& path, std::string& text)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	std::stringstream stream;
+	stream << file.rdbuf();
+	text = stream.str();
+	return true;
+}
+
+/// <summary>
+/// The directive name if the line is a preprocessor directive ("include", "version"), otherwise empty.
+/// rest is left pointing after the name
+/// </summary>
+static std::string DirectiveName(const std::string& line, size_t& rest)
+{
+	size_t position = line.find_first_not_of(" \t");
+	if (position == std::string::npos || line[position] != '#')
+	{
+		return std::string();
+	}
+	position = line.find_first_not_of(" \t", position + 1);
+	if (position == std::string::npos)
+	{
+		return std::string();
+	}
+	size_t end = position;
+	while (end < line.size() && isalpha((unsigned char)line[end]))
+	{
+		end++;
+	}
+	rest = end;
+	return line.substr(position, end - position);
+}
+
+static bool ProcessFile(ShaderPreprocessState& state, const std::filesystem::path& path, unsigned int depth)
+{
+	if (depth > ShaderMaxIncludeDepth)
+	{
+		std::cout << "ERROR::SHADER::INCLUDE_TOO_DEEP " << path.string() << std::endl;
+		return false;
+	}
+	std::string text;
+	if (!ReadTextFile(path.string(), text))
+	{
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ " << path.string() << std::endl;
+		return false;
+	}
+	unsigned int fileIndex = (unsigned int)state.Files.size();
+	state.Files.push_back(path.lexically_normal().string());
+
+	std::istringstream lines(text);
+	std::string line;
+	unsigned int lineNumber = 0;
+	bool versionSeen = false;
+	while (std::getline(lines, line))
+	{
+		lineNumber++;
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+		size_t rest = 0;
+		std::string directive = DirectiveName(line, rest);
+		if (directive == "version")
+		{
+			// Only the shader's own #version counts, an include can't have one after code
+			if (depth == 0 && !versionSeen)
+			{
+				state.Output += line + "\n" + state.Defines + "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+				versionSeen = true;
+			}
+			else
+			{
+				state.Output += "\n";
+			}
+			continue;
+		}
+		if (directive != "include")
+		{
+			state.Output += line + "\n";
+			continue;
+		}
+
+		size_t open = line.find('"', rest);
+		size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+		if (close == std::string::npos)
+		{
+			std::cout << "ERROR::SHADER::BAD_INCLUDE " << path.string() << ":" << lineNumber << std::endl;
+			return false;
+		}
+		std::filesystem::path includePath = (path.parent_path() / line.substr(open + 1, close - open - 1)).lexically_normal();
+		bool alreadyIncluded = false;
+		for (const std::string& file : state.Files)
+		{
+			alreadyIncluded |= file == includePath.string();
+		}
+		if (!alreadyIncluded)
+		{
+			state.Output += "#line 1 " + std::to_string(state.Files.size()) + "\n";
+			if (!ProcessFile(state, includePath, depth + 1))
+			{
+				return false;
+			}
+		}
+		state.Output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+	}
+	if (depth == 0 && !versionSeen)
+	{
+		// No #version, the defines can simply go first
+		state.Output = state.Defines + "#line 1 0\n" + state.Output;
+	}
+	return true;
+}
+
+/// <summary>
+/// Reads a shader file with its includes resolved and the defines injected
+/// </summary>
+/// <param name="path"> shader file </param>
+/// <param name="defines"> lines put after #version </param>
+/// <param name="source"> the finished source </param>
+/// <param name="files"> optional, filled with every file read (for reloading when one changes) </param>
+/// <returns> false if a file could not be read or an include was malformed or cyclic </returns>
+bool PreprocessShader(const std::string& path, const std::string& defines, std::string& source, std::vector<std::string>* files)
+{
+	ShaderPreprocessState state;
+	state.Defines = defines;
+	bool success = ProcessFile(state, std::filesystem::path(path), 0);
+	if (files)
+	{
+		*files = state.Files;
+	}
+	source = success ? state.Output : std::string();
+	return success;
+}
@@ -0,0 +1,24 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Turns a shader file into the source handed to glShaderSource. #include "file" is resolved relative to
+/// the including file, each file at most once per shader (so shared block declarations can be included anywhere).
+/// Defines are injected straight after #version, which has to stay the first line. #line directives keep the
+/// driver's error messages pointing at the right line, the source string number in them is the file's position in
+/// the files list: 0 is the shader itself, then includes in the order they were first seen.
+/// -----------------
+
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#pragma region Includes
+
+#include <string>
+#include <vector>
+
+#pragma endregion Includes
+
+// defines is inserted as is, e.g. "#define BLEND_TEXTURE2 1\n". files, when given, gets every file that was read
+bool PreprocessShader(const std::string& path, const std::string& defines, std::string& source, std::vector<std::string>* files = nullptr);
+
+#endif // !SHADER_PREPROCESSOR_H
@@ -0,0 +1,167 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: On demand shader permutations
+/// -----------------
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#include "GLStateCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderVariants.h"
+
+ShaderVariants::ShaderVariants(ShaderCompiler& compiler, const std::string& vertexPath, const std::string& fragmentPath,
+	const std::vector<std::string>& features)
+	: _compiler(compiler), _vertexPath(vertexPath), _fragmentPath(fragmentPath), _features(features)
+{
+	if (_features.size() > 32)
+	{
+		std::cout << "ERROR::SHADER::TOO_MANY_VARIANT_FEATURES " << _features.size() << std::endl;
+		_features.resize(32);
+	}
+}
+
+void ShaderVariants::SetOnReady(std::function<void(Shader&)> onReady)
+{
+	_onReady = std::move(onReady);
+}
+
+/// <summary>
+/// Gets a variant, submitting it for compilation the first time it is asked for
+/// </summary>
+/// <param name="mask"> bit i turns on the i-th feature, bits past the feature list are ignored </param>
+/// <returns> the finished program, or null while it compiles or if it failed </returns>
+const Shader* ShaderVariants::Request(uint32_t mask)
+{
+	if (_features.size() < 32)
+	{
+		mask &= (1u << _features.size()) - 1;
+	}
+	auto found = _variants.find(mask);
+	if (found == _variants.end())
+	{
+		Variant& variant = _variants[mask];
+		variant.Pending = _compiler.Submit(_vertexPath.c_str(), _fragmentPath.c_str(), DefinesFor(mask));
+		return nullptr;
+	}
+
+	Variant& variant = found->second;
+	if (!variant.Ready)
+	{
+		if (!variant.Pending.valid() || variant.Pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			return nullptr;
+		}
+		variant.Program = variant.Pending.get();
+		variant.SourceFiles = variant.Program.GetSourceFiles();
+		variant.Ready = true;
+		if (variant.Program.ID != 0 && _onReady)
+		{
+			_onReady(variant.Program);
+		}
+	}
+	if (variant.Reloading.valid() && variant.Reloading.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		FinishReload(mask, variant);
+	}
+	return variant.Program.ID != 0 ? &variant.Program : nullptr;
+}
+
+/// <summary>
+/// Starts rebuilding every finished variant that read one of the changed files
+/// </summary>
+void ShaderVariants::Reload(const std::vector<std::string>& changedFiles)
+{
+	for (std::pair<const uint32_t, Variant>& entry : _variants)
+	{
+		Variant& variant = entry.second;
+		if (!variant.Ready)
+		{
+			// Still on its first build, which may already have read the old file. Rare enough to leave
+			continue;
+		}
+		bool affected = false;
+		for (const std::string& changed : changedFiles)
+		{
+			std::string normalized = std::filesystem::path(changed).lexically_normal().string();
+			affected |= std::find(variant.SourceFiles.begin(), variant.SourceFiles.end(), normalized) != variant.SourceFiles.end();
+		}
+		if (!affected)
+		{
+			continue;
+		}
+		if (variant.Reloading.valid())
+		{
+			variant.ReloadAgain = true;
+		}
+		else
+		{
+			SubmitReload(entry.first, variant);
+		}
+	}
+}
+
+void ShaderVariants::SubmitReload(uint32_t mask, Variant& variant)
+{
+	variant.ReloadStart = std::chrono::steady_clock::now();
+	variant.ReloadAgain = false;
+	variant.Reloading = _compiler.Submit(_vertexPath.c_str(), _fragmentPath.c_str(), DefinesFor(mask));
+}
+
+/// <summary>
+/// Swaps a rebuilt program in, or keeps the old one if the rebuild failed
+/// </summary>
+void ShaderVariants::FinishReload(uint32_t mask, Variant& variant)
+{
+	Shader reloaded = variant.Reloading.get();
+	variant.SourceFiles = reloaded.GetSourceFiles();
+	if (variant.ReloadAgain)
+	{
+		if (reloaded.ID != 0)
+		{
+			GLStateCache::Instance().DeleteProgram(reloaded.ID);
+		}
+		SubmitReload(mask, variant);
+		return;
+	}
+	double reloadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - variant.ReloadStart).count();
+	if (reloaded.ID == 0)
+	{
+		// The compiler has printed the log
+		std::cout << "Shader reload failed, keeping the previous program" << std::endl;
+		return;
+	}
+
+	unsigned int previous = variant.Program.ID;
+	variant.Program = std::move(reloaded);
+	if (previous != 0)
+	{
+		GLStateCache::Instance().DeleteProgram(previous);
+	}
+	if (_onReady)
+	{
+		_onReady(variant.Program);
+	}
+	std::cout << "Shader reloaded: " << _vertexPath << "/" << _fragmentPath << " mask " << mask << " in " << reloadMs << " ms" << std::endl;
+}
+
+/// <summary>
+/// The #define lines a mask turns into, in feature order so equal masks always give the same source
+/// </summary>
+std::string ShaderVariants::DefinesFor(uint32_t mask) const
+{
+	std::string defines;
+	for (size_t bit = 0; bit < _features.size(); bit++)
+	{
+		if (mask & (1u << bit))
+		{
+			defines += "#define " + _features[bit] + " 1\n";
+		}
+	}
+	return defines;
+}
+
+size_t ShaderVariants::VariantCount() const
+{
+	return _variants.size();
+}
@@ -0,0 +1,83 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Permutations of one vertex/fragment pair, keyed by a bitmask of features. Bit i defines the i-th
+/// feature name, so a shader can #ifdef code out instead of branching on a uniform at run time. Nothing is
+/// compiled up front: the first Request for a mask submits that variant to the ShaderCompiler, and Request keeps
+/// returning null until the compiler has finished it, so only the variants a scene actually draws get built.
+/// Reload recompiles the variants built from changed files (includes count) the same way. A variant keeps drawing
+/// with its old program until the new one has linked, then Request swaps the program, its uniform locations and
+/// block indices over in one go on the GL thread and runs OnReady again. If the new one fails the old one stays.
+/// -----------------
+
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#pragma region Includes
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Shader.h"
+
+#pragma endregion Includes
+
+class ShaderCompiler;
+
+class ShaderVariants
+{
+public:
+
+	// The compiler has to outlive this
+	ShaderVariants(ShaderCompiler& compiler, const std::string& vertexPath, const std::string& fragmentPath,
+		const std::vector<std::string>& features);
+
+	ShaderVariants(const ShaderVariants&) = delete;
+	ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+	// Runs on the GL thread once per variant as it finishes, for sampler units, uniform block bindings and so on
+	void SetOnReady(std::function<void(Shader&)> onReady);
+
+	// GL thread only. Null while the variant compiles or if it failed
+	const Shader* Request(uint32_t mask);
+	std::string DefinesFor(uint32_t mask) const;
+
+	// GL thread only. changedFiles as FileWatcher reports them
+	void Reload(const std::vector<std::string>& changedFiles);
+
+	// Variants requested so far, finished or not
+	size_t VariantCount() const;
+
+private:
+
+	struct Variant
+	{
+		std::future<Shader> Pending;
+		Shader Program;
+		bool Ready = false;
+		// Kept apart from Program, a failed build has no program but its files still have to be watched
+		std::vector<std::string> SourceFiles;
+
+		std::future<Shader> Reloading;
+		std::chrono::steady_clock::time_point ReloadStart;
+		// Changed again while reloading, the result is stale and gets rebuilt
+		bool ReloadAgain = false;
+	};
+
+	ShaderCompiler& _compiler;
+	std::string _vertexPath;
+	std::string _fragmentPath;
+	std::vector<std::string> _features;
+	std::function<void(Shader&)> _onReady;
+	std::unordered_map<uint32_t, Variant> _variants;
+
+	void SubmitReload(uint32_t mask, Variant& variant);
+	void FinishReload(uint32_t mask, Variant& variant);
+};
+
+#endif // !SHADER_VARIANTS_H
@@ -0,0 +1,276 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Streaming vertex buffer sprite renderer
+/// -----------------
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+
+#include "GLStateCache.h"
+#include "Profiler.h"
+#include "SpriteBatch.h"
+
+struct SpriteVertex
+{
+	float X;
+	float Y;
+	float U;
+	float V;
+	uint32_t Color;
+	float Blend;
+};
+
+const size_t SpriteBytes = 4 * sizeof(SpriteVertex);
+
+SpriteBatch::~SpriteBatch()
+{
+	Release();
+}
+
+/// <summary>
+/// Creates the vertex array, the streaming vertex buffer and the shared index pattern
+/// </summary>
+void SpriteBatch::Create()
+{
+	GLStateCache& state = GLStateCache::Instance();
+	glGenVertexArrays(1, &_vertexArray);
+	glGenBuffers(1, &_vertexBuffer);
+	glGenBuffers(1, &_indexBuffer);
+
+	state.BindVertexArray(_vertexArray);
+	state.BindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(SpriteBatchCapacity * SpriteBytes), NULL, GL_STREAM_DRAW);
+
+	// Two triangles per quad, corners go bottom left, bottom right, top right, top left
+	std::vector<uint16_t> indices(SpritesPerDraw * 6);
+	for (unsigned int sprite = 0; sprite < SpritesPerDraw; sprite++)
+	{
+		uint16_t corner = (uint16_t)(sprite * 4);
+		uint16_t* quad = &indices[sprite * 6];
+		quad[0] = corner;
+		quad[1] = (uint16_t)(corner + 1);
+		quad[2] = (uint16_t)(corner + 2);
+		quad[3] = (uint16_t)(corner + 2);
+		quad[4] = (uint16_t)(corner + 3);
+		quad[5] = corner;
+	}
+	state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(indices.size() * sizeof(uint16_t)), indices.data(), GL_STATIC_DRAW);
+
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, X));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, U));
+	glEnableVertexAttribArray(1);
+	// RGBA8 normalized to [0, 1]
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, Color));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, Blend));
+	glEnableVertexAttribArray(3);
+
+	state.BindVertexArray(0);
+	state.BindBuffer(GL_ARRAY_BUFFER, 0);
+	_cursor = 0;
+}
+
+void SpriteBatch::Release()
+{
+	GLStateCache& state = GLStateCache::Instance();
+	if (_vertexArray != 0)
+	{
+		state.DeleteVertexArray(_vertexArray);
+		_vertexArray = 0;
+	}
+	if (_vertexBuffer != 0)
+	{
+		state.DeleteBuffer(_vertexBuffer);
+		_vertexBuffer = 0;
+	}
+	if (_indexBuffer != 0)
+	{
+		state.DeleteBuffer(_indexBuffer);
+		_indexBuffer = 0;
+	}
+	_sprites.clear();
+}
+
+/// <summary>
+/// Program built from the sprite shaders, nothing is drawn until it is set
+/// </summary>
+void SpriteBatch::SetProgram(unsigned int program)
+{
+	_program = program;
+}
+
+/// <summary>
+/// Starts collecting sprites, any left over from a Begin without an End are dropped
+/// </summary>
+void SpriteBatch::Begin(float viewWidth, float viewHeight, SpriteSortMode sortMode)
+{
+	_scaleX = 2.0f / viewWidth;
+	_scaleY = 2.0f / viewHeight;
+	_sortMode = sortMode;
+	_sprites.clear();
+}
+
+/// <summary>
+/// Queues a sprite
+/// </summary>
+/// <param name="texture"> GL texture name </param>
+/// <param name="destination"> where to draw it, in pixels </param>
+/// <param name="uv"> part of the texture to show, the whole texture by default </param>
+/// <param name="color"> tint target and opacity </param>
+/// <param name="blend"> 0 shows the texture as is, 1 is a flat color </param>
+void SpriteBatch::Draw(unsigned int texture, const SpriteRect& destination, const SpriteRect& uv, uint32_t color, float blend)
+{
+	_sprites.push_back({ texture, destination, uv, color, blend });
+}
+
+/// <summary>
+/// Writes every queued sprite into the vertex buffer and draws them
+/// </summary>
+void SpriteBatch::End()
+{
+	ProfileZone zone("Sprite batch");
+	_lastDrawCalls = 0;
+	_lastWriteMs = 0.0;
+	unsigned int total = (unsigned int)_sprites.size();
+	if (total == 0 || _program == 0 || _vertexArray == 0)
+	{
+		_sprites.clear();
+		return;
+	}
+
+	_order.resize(total);
+	for (unsigned int i = 0; i < total; i++)
+	{
+		_order[i] = i;
+	}
+	if (_sortMode == SpriteSortMode::Texture)
+	{
+		std::stable_sort(_order.begin(), _order.end(), [this](uint32_t a, uint32_t b)
+		{
+			return _sprites[a].Texture < _sprites[b].Texture;
+		});
+	}
+
+	GLStateCache& state = GLStateCache::Instance();
+	state.UseProgram(_program);
+	state.BindVertexArray(_vertexArray);
+	state.BindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+	state.SetCapability(GL_BLEND, true);
+	state.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	unsigned int written = 0;
+	while (written < total)
+	{
+		unsigned int count = std::min(total - written, SpriteBatchCapacity);
+		if (_cursor + count > SpriteBatchCapacity)
+		{
+			// Full, fresh storage lets the GPU keep reading the old one while this frame writes
+			glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(SpriteBatchCapacity * SpriteBytes), NULL, GL_STREAM_DRAW);
+			_cursor = 0;
+		}
+		if (!WriteVertices(written, count))
+		{
+			break;
+		}
+
+		// One draw per run of the same texture
+		unsigned int runStart = 0;
+		for (unsigned int i = 1; i <= count; i++)
+		{
+			unsigned int runTexture = _sprites[_order[written + runStart]].Texture;
+			if (i == count || _sprites[_order[written + i]].Texture != runTexture)
+			{
+				DrawRun(runTexture, _cursor + runStart, i - runStart);
+				runStart = i;
+			}
+		}
+		_cursor += count;
+		written += count;
+	}
+	Profiler::Instance().CountDrawCalls(_lastDrawCalls);
+	_sprites.clear();
+}
+
+/// <summary>
+/// Writes quads for sprites [first, first + count) of the draw order at the cursor
+/// </summary>
+/// <returns> false if the buffer could not be mapped </returns>
+bool SpriteBatch::WriteVertices(unsigned int first, unsigned int count)
+{
+	ProfileZone zone("Sprite vertices");
+	auto start = std::chrono::steady_clock::now();
+	// Nothing drawn since the last orphan uses this range, so there is nothing to synchronize with
+	SpriteVertex* vertices = (SpriteVertex*)glMapBufferRange(GL_ARRAY_BUFFER, (GLintptr)(_cursor * SpriteBytes),
+		(GLsizeiptr)(count * SpriteBytes), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (!vertices)
+	{
+		std::cout << "ERROR::SPRITE_BATCH::MAP_FAILED" << std::endl;
+		return false;
+	}
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const Sprite& sprite = _sprites[_order[first + i]];
+		float left = sprite.Destination.X * _scaleX - 1.0f;
+		float bottom = sprite.Destination.Y * _scaleY - 1.0f;
+		float right = left + sprite.Destination.Width * _scaleX;
+		float top = bottom + sprite.Destination.Height * _scaleY;
+		float u0 = sprite.UV.X;
+		float v0 = sprite.UV.Y;
+		float u1 = u0 + sprite.UV.Width;
+		float v1 = v0 + sprite.UV.Height;
+		SpriteVertex* quad = vertices + i * 4;
+		quad[0] = { left, bottom, u0, v0, sprite.Color, sprite.Blend };
+		quad[1] = { right, bottom, u1, v0, sprite.Color, sprite.Blend };
+		quad[2] = { right, top, u1, v1, sprite.Color, sprite.Blend };
+		quad[3] = { left, top, u0, v1, sprite.Color, sprite.Blend };
+	}
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+	Profiler::Instance().CountUploadBytes(count * SpriteBytes);
+	_lastWriteMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+/// <summary>
+/// Draws sprites already in the vertex buffer, split so the 16 bit indices never overflow
+/// </summary>
+/// <param name="firstSprite"> slot in the vertex buffer </param>
+void SpriteBatch::DrawRun(unsigned int texture, unsigned int firstSprite, unsigned int count)
+{
+	GLStateCache::Instance().BindTexture(0, GL_TEXTURE_2D, texture);
+	while (count > 0)
+	{
+		unsigned int drawCount = std::min(count, SpritesPerDraw);
+		glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)(drawCount * 6), GL_UNSIGNED_SHORT, (void*)0, (GLint)(firstSprite * 4));
+		_lastDrawCalls++;
+		firstSprite += drawCount;
+		count -= drawCount;
+	}
+}
+
+unsigned int SpriteBatch::LastDrawCalls() const
+{
+	return _lastDrawCalls;
+}
+
+double SpriteBatch::LastWriteMs() const
+{
+	return _lastWriteMs;
+}
+
+/// <summary>
+/// Packs a color into the RGBA8 layout the vertex buffer stores
+/// </summary>
+uint32_t PackSpriteColor(float r, float g, float b, float a)
+{
+	auto toByte = [](float value)
+	{
+		value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+		return (uint32_t)(value * 255.0f + 0.5f);
+	};
+	return toByte(r) | (toByte(g) << 8) | (toByte(b) << 16) | (toByte(a) << 24);
+}
@@ -0,0 +1,101 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Draws large numbers of textured quads with a handful of draw calls. Draw only stores the sprite,
+/// End writes the quads' vertices into a streaming vertex buffer and issues one draw per run of sprites sharing a
+/// texture. The buffer is appended to with unsynchronized maps and orphaned when it fills, so the CPU never waits on
+/// the GPU for the memory. Indices are a fixed pattern built once, each draw offsets into it with a base vertex.
+/// Uses SpriteVertexShader.vert / SpriteFragmentShader.frag.
+/// -----------------
+
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#pragma region Includes
+
+#include <cstdint>
+#include <vector>
+
+#pragma endregion Includes
+
+// Sprites the vertex buffer holds before it is orphaned
+const unsigned int SpriteBatchCapacity = 65536;
+// Sprites per draw call, keeps the indices 16 bit
+const unsigned int SpritesPerDraw = 16384;
+
+struct SpriteRect
+{
+	float X = 0.0f;
+	float Y = 0.0f;
+	float Width = 1.0f;
+	float Height = 1.0f;
+};
+
+enum class SpriteSortMode
+{
+	// Drawn in submission order, a new draw starts whenever the texture changes
+	Deferred,
+	// Grouped by texture first, fewest draws but overlapping sprites with different textures can reorder
+	Texture
+};
+
+class SpriteBatch
+{
+public:
+
+	SpriteBatch() = default;
+	~SpriteBatch();
+
+	SpriteBatch(const SpriteBatch&) = delete;
+	SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+	// GL thread only
+	void Create();
+	void Release();
+	void SetProgram(unsigned int program);
+
+	// Positions are in pixels of a view this size, origin bottom left
+	void Begin(float viewWidth, float viewHeight, SpriteSortMode sortMode = SpriteSortMode::Deferred);
+	// Color is RGBA8 (see PackSpriteColor), blend moves the texture color towards it, 0 is just the texture
+	void Draw(unsigned int texture, const SpriteRect& destination, const SpriteRect& uv = SpriteRect(),
+		uint32_t color = 0xFFFFFFFFu, float blend = 0.0f);
+	void End();
+
+	// Draw calls issued by the last End
+	unsigned int LastDrawCalls() const;
+	// Time the last End spent writing vertices, the rest of End is driver time
+	double LastWriteMs() const;
+
+private:
+
+	struct Sprite
+	{
+		unsigned int Texture;
+		SpriteRect Destination;
+		SpriteRect UV;
+		uint32_t Color;
+		float Blend;
+	};
+
+	unsigned int _program = 0;
+	unsigned int _vertexArray = 0;
+	unsigned int _vertexBuffer = 0;
+	unsigned int _indexBuffer = 0;
+	// Next free sprite slot in the vertex buffer
+	unsigned int _cursor = 0;
+
+	float _scaleX = 1.0f;
+	float _scaleY = 1.0f;
+	SpriteSortMode _sortMode = SpriteSortMode::Deferred;
+	std::vector<Sprite> _sprites;
+	std::vector<uint32_t> _order;
+	unsigned int _lastDrawCalls = 0;
+	double _lastWriteMs = 0.0;
+
+	bool WriteVertices(unsigned int first, unsigned int count);
+	void DrawRun(unsigned int texture, unsigned int firstSprite, unsigned int count);
+};
+
+uint32_t PackSpriteColor(float r, float g, float b, float a);
+
+#endif // !SPRITE_BATCH_H
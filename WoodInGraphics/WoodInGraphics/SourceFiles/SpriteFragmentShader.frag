@@ -0,0 +1,17 @@
+#version 330 core
+
+out vec4 fragColor;
+
+in vec2 texCoord;
+in vec4 spriteColor;
+in float blendWeight;
+
+uniform sampler2D spriteTexture;
+
+
+void main()
+{
+    // Blend weight fades the texture towards the sprite color, the color alpha is the opacity
+    vec4 texel = texture(spriteTexture, texCoord);
+    fragColor = vec4(mix(texel.rgb, spriteColor.rgb, blendWeight), texel.a * spriteColor.a);
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 330 core
+
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aColor;
+layout (location = 3) in float aBlend;
+
+out vec2 texCoord;
+out vec4 spriteColor;
+out float blendWeight;
+
+void main()
+{
+	gl_Position = vec4(aPos, 0.0f, 1.0f);
+	texCoord = aTexCoord;
+	spriteColor = aColor;
+	blendWeight = aBlend;
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Fenced pixel unpack ring buffer for streaming texture uploads
+/// -----------------
+#include <glad/glad.h>
+
+#include <iostream>
+
+#include "GLStateCache.h"
+#include "StagingRing.h"
+
+// Keeps every region aligned for any pixel format and for fast memcpy
+const size_t StagingAlignment = 256;
+
+StagingRing::~StagingRing()
+{
+	Destroy();
+}
+
+/// <summary>
+/// Creates the buffer, persistently mapped when the driver supports it
+/// </summary>
+/// <param name="capacity"> size of the ring in bytes </param>
+/// <returns> false if the buffer could not be created or mapped </returns>
+bool StagingRing::Create(size_t capacity)
+{
+	_capacity = capacity;
+	_allocated = 0;
+	_freed = 0;
+	_persistent = GLAD_GL_ARB_buffer_storage != 0;
+
+	glGenBuffers(1, &_buffer);
+	GLStateCache::Instance().BindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+	if (_persistent)
+	{
+		// Coherent so the workers' memcpy is visible to the GPU without flushing
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)capacity, NULL, flags);
+		_mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)capacity, flags);
+		if (!_mapped)
+		{
+			std::cout << "ERROR::STAGING_RING::PERSISTENT_MAP_FAILED" << std::endl;
+			GLStateCache::Instance().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			Destroy();
+			return false;
+		}
+	}
+	else
+	{
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)capacity, NULL, GL_STREAM_DRAW);
+	}
+	GLStateCache::Instance().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return true;
+}
+
+/// <summary>
+/// Waits for every fence and deletes the buffer
+/// </summary>
+void StagingRing::Destroy()
+{
+	for (PendingFence& fence : _fences)
+	{
+		glClientWaitSync((GLsync)fence.Sync, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync((GLsync)fence.Sync);
+	}
+	_fences.clear();
+
+	if (_buffer != 0)
+	{
+		if (_mapped)
+		{
+			GLStateCache::Instance().BindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			GLStateCache::Instance().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		GLStateCache::Instance().DeleteBuffer(_buffer);
+	}
+	_buffer = 0;
+	_mapped = nullptr;
+	_capacity = 0;
+}
+
+bool StagingRing::IsPersistent() const
+{
+	return _persistent && _mapped != nullptr;
+}
+
+unsigned int StagingRing::GetBufferID() const
+{
+	return _buffer;
+}
+
+size_t StagingRing::GetCapacity() const
+{
+	return _capacity;
+}
+
+/// <summary>
+/// Reserves a region of the persistent mapping. Safe to call from worker threads
+/// </summary>
+/// <param name="size"> bytes needed </param>
+/// <param name="allocation"> filled with the region on success </param>
+/// <returns> false when the ring is full (or not persistent), the caller should upload from client memory instead </returns>
+bool StagingRing::Allocate(size_t size, StagingAllocation& allocation)
+{
+	if (!IsPersistent() || size == 0 || size > _capacity)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	size_t offset = (size_t)(_allocated % _capacity);
+	size_t padding = (StagingAlignment - offset % StagingAlignment) % StagingAlignment;
+	if (offset + padding + size > _capacity)
+	{
+		// Does not fit before the end, skip to the start of the buffer
+		padding = _capacity - offset;
+	}
+	if (_allocated + padding + size - _freed > _capacity)
+	{
+		return false;
+	}
+
+	_allocated += padding + size;
+	allocation.Offset = (size_t)((_allocated - size) % _capacity);
+	allocation.End = _allocated;
+	allocation.Memory = _mapped + allocation.Offset;
+	return true;
+}
+
+/// <summary>
+/// Marks everything up to end as submitted, it becomes free again once the GPU passes the fence
+/// </summary>
+/// <param name="end"> End of the last allocation uploaded this frame </param>
+void StagingRing::Fence(unsigned long long end)
+{
+	PendingFence fence;
+	fence.Sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	fence.End = end;
+	_fences.push_back(fence);
+}
+
+/// <summary>
+/// Frees regions whose fences have signaled, never blocks
+/// </summary>
+void StagingRing::Reclaim()
+{
+	while (!_fences.empty())
+	{
+		PendingFence& fence = _fences.front();
+		GLenum result = glClientWaitSync((GLsync)fence.Sync, 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+		{
+			break;
+		}
+		glDeleteSync((GLsync)fence.Sync);
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_freed = fence.End;
+		}
+		_fences.pop_front();
+	}
+}
+
+/// <summary>
+/// Fallback path: gives the buffer fresh storage and maps it, so writing never waits on the GPU.
+/// Leaves the buffer bound to GL_PIXEL_UNPACK_BUFFER, call Unmap before uploading from offset 0
+/// </summary>
+/// <param name="size"> bytes needed </param>
+/// <returns> pointer to write the pixels to, null if the map failed </returns>
+unsigned char* StagingRing::Orphan(size_t size)
+{
+	GLStateCache::Instance().BindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+	if (size > _capacity)
+	{
+		_capacity = size;
+	}
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)_capacity, NULL, GL_STREAM_DRAW);
+	return (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+}
+
+/// <summary>
+/// Ends the write started by Orphan
+/// </summary>
+void StagingRing::Unmap()
+{
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+}
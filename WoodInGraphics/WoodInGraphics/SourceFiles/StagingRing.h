@@ -0,0 +1,75 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Ring of pixel unpack buffer memory used to stream texture uploads. With GL_ARB_buffer_storage the
+/// buffer is persistently mapped and any thread can copy into it, regions are handed back once the GPU has passed
+/// the fence placed after their upload. Without it every upload orphans the buffer with glBufferData instead.
+/// -----------------
+
+#ifndef STAGING_RING_H
+#define STAGING_RING_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+#pragma endregion Includes
+
+// Region handed out by Allocate. End is the running byte total and is what Fence takes
+struct StagingAllocation
+{
+	size_t Offset = 0;
+	unsigned long long End = 0;
+	unsigned char* Memory = nullptr;
+};
+
+class StagingRing
+{
+public:
+
+	StagingRing() = default;
+	~StagingRing();
+
+	StagingRing(const StagingRing&) = delete;
+	StagingRing& operator=(const StagingRing&) = delete;
+
+	bool Create(size_t capacity);
+	void Destroy();
+
+	bool IsPersistent() const;
+	unsigned int GetBufferID() const;
+	size_t GetCapacity() const;
+
+	// Thread safe, only works on the persistent path. Regions must be uploaded and fenced in allocation order
+	bool Allocate(size_t size, StagingAllocation& allocation);
+
+	// GL thread only
+	void Fence(unsigned long long end);
+	void Reclaim();
+	unsigned char* Orphan(size_t size);
+	void Unmap();
+
+private:
+
+	struct PendingFence
+	{
+		void* Sync = nullptr;
+		unsigned long long End = 0;
+	};
+
+	unsigned int _buffer = 0;
+	size_t _capacity = 0;
+	unsigned char* _mapped = nullptr;
+	bool _persistent = false;
+
+	// Running totals, offset in the buffer is total % capacity. Allocations that would wrap
+	// pad up to the end of the buffer so this always holds
+	std::mutex _mutex;
+	unsigned long long _allocated = 0;
+	unsigned long long _freed = 0;
+	std::deque<PendingFence> _fences;
+};
+
+#endif // !STAGING_RING_H
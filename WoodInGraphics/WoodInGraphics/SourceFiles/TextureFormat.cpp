@@ -0,0 +1,87 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Format selection for uncompressed textures
+/// -----------------
+#include <glad/glad.h>
+
+#include "GLStateCache.h"
+#include "TextureFormat.h"
+
+/// <summary>
+/// Tightest sized internal format that holds the image without losing anything
+/// </summary>
+/// <param name="channels"> 1 grey, 2 grey alpha, 3 RGB, 4 RGBA </param>
+/// <param name="bitDepth"> bits per channel of integer images, 8 or 16 </param>
+/// <param name="srgb"> color data that should be decoded to linear when sampled </param>
+/// <param name="hdr"> float pixels </param>
+PixelFormat SelectPixelFormat(int channels, int bitDepth, bool srgb, bool hdr)
+{
+	static const GLenum Formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+	static const GLenum Float16Formats[4] = { GL_R16F, GL_RG16F, GL_RGB16F, GL_RGBA16F };
+	static const GLenum Unorm16Formats[4] = { GL_R16, GL_RG16, GL_RGB16, GL_RGBA16 };
+	static const GLenum Unorm8Formats[4] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+
+	int index = (channels < 1 || channels > 4) ? 3 : channels - 1;
+	PixelFormat format;
+	format.Format = Formats[index];
+	if (hdr)
+	{
+		format.InternalFormat = Float16Formats[index];
+		format.Type = GL_FLOAT;
+		format.BytesPerPixel = (index + 1) * 4;
+	}
+	else if (bitDepth == 16)
+	{
+		format.InternalFormat = Unorm16Formats[index];
+		format.Type = GL_UNSIGNED_SHORT;
+		format.BytesPerPixel = (index + 1) * 2;
+	}
+	else
+	{
+		format.InternalFormat = Unorm8Formats[index];
+		if (srgb && index == 2)
+		{
+			format.InternalFormat = GL_SRGB8;
+		}
+		else if (srgb && index == 3)
+		{
+			format.InternalFormat = GL_SRGB8_ALPHA8;
+		}
+		format.Type = GL_UNSIGNED_BYTE;
+		format.BytesPerPixel = index + 1;
+	}
+	return format;
+}
+
+/// <summary>
+/// The default of 4 reads past the end of every row of an odd width RGB or grey image
+/// </summary>
+/// <param name="rowBytes"> bytes in one tightly packed row </param>
+void SetUnpackAlignment(size_t rowBytes)
+{
+	GLint alignment = 8;
+	while (rowBytes % (size_t)alignment != 0)
+	{
+		alignment /= 2;
+	}
+	GLStateCache::Instance().PixelStore(GL_UNPACK_ALIGNMENT, alignment);
+}
+
+/// <summary>
+/// Set on the texture bound to target
+/// </summary>
+/// <param name="channels"> channel count the texture was created with </param>
+/// <param name="target"> GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY </param>
+void ApplyChannelSwizzle(int channels, unsigned int target)
+{
+	if (channels == 1)
+	{
+		const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+		glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+	}
+	else if (channels == 2)
+	{
+		const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+		glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+	}
+}
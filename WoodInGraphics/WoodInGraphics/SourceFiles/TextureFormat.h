@@ -0,0 +1,37 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Picks the GL formats for an uncompressed image from what the decoder actually returned, so a
+/// one channel mask is stored as GL_R8 instead of being expanded to GL_RGB, and sets the unpack state to match.
+/// -----------------
+
+#ifndef TEXTURE_FORMAT_H
+#define TEXTURE_FORMAT_H
+
+#pragma region Includes
+
+#include <cstddef>
+
+#pragma endregion Includes
+
+// Arguments for glTexImage2D, GL enums are kept as unsigned int so this header does not need glad
+struct PixelFormat
+{
+	unsigned int InternalFormat = 0;
+	unsigned int Format = 0;
+	unsigned int Type = 0;
+	int BytesPerPixel = 0;
+};
+
+// bitDepth is 8 or 16, hdr means 32 bit float pixels which are stored as half floats.
+// sRGB only changes 3 and 4 channel 8 bit images, GL has no sRGB version of the others
+PixelFormat SelectPixelFormat(int channels, int bitDepth, bool srgb, bool hdr);
+
+// GL thread only. Sets GL_UNPACK_ALIGNMENT to the largest value rows of this size are aligned to
+void SetUnpackAlignment(size_t rowBytes);
+
+// GL thread only. Makes 1 and 2 channel textures sample as grey and grey + alpha instead of red and red + green.
+// target is the bound texture's, GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+void ApplyChannelSwizzle(int channels, unsigned int target);
+
+#endif // !TEXTURE_FORMAT_H
@@ -0,0 +1,558 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Background texture loading, decode on the workers and upload on the GL thread
+/// -----------------
+#include <glad/glad.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "GLStateCache.h"
+#include "KTX2.h"
+#include "Profiler.h"
+#include "TextureFormat.h"
+#include "TextureManager.h"
+#include "stb_image.h"
+
+/// <summary>
+/// GL internal format for a baked KTX2 format
+/// </summary>
+/// <returns> 0 if the format is unknown or the driver can't sample it </returns>
+static GLenum CompressedInternalFormat(unsigned int vkFormat)
+{
+	bool s3tc = GLAD_GL_EXT_texture_compression_s3tc != 0;
+	bool s3tcSRGB = s3tc && GLAD_GL_EXT_texture_sRGB != 0;
+	// BPTC is core from 4.2
+	bool bptc = GLAD_GL_ARB_texture_compression_bptc != 0 || GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 2);
+	switch (vkFormat)
+	{
+	case VkFormatBC1RGBUnorm: return s3tc ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : 0;
+	case VkFormatBC1RGBSRGB: return s3tcSRGB ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : 0;
+	case VkFormatBC3Unorm: return s3tc ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : 0;
+	case VkFormatBC3SRGB: return s3tcSRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : 0;
+	case VkFormatBC7Unorm: return bptc ? GL_COMPRESSED_RGBA_BPTC_UNORM_ARB : 0;
+	case VkFormatBC7SRGB: return bptc ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB : 0;
+	default: return 0;
+	}
+}
+
+/// <summary>
+/// Needs a current GL context, creates the placeholder texture shown while loads are in flight
+/// </summary>
+/// <param name="workerCount"> number of decode threads, 0 uses one per hardware thread </param>
+/// <param name="stagingBytes"> size of the staging ring, textures bigger than this upload from client memory </param>
+TextureManager::TextureManager(unsigned int workerCount, size_t stagingBytes)
+	: _workers(workerCount)
+{
+	_staging.Create(stagingBytes);
+
+	// 1x1 mid grey, neutral enough that a missing texture is noticeable without being distracting
+	const unsigned char placeholderPixel[4] = { 128, 128, 128, 255 };
+	GLStateCache& state = GLStateCache::Instance();
+	glGenTextures(1, &_placeholderID);
+	state.BindTexture(GL_TEXTURE_2D, _placeholderID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholderPixel);
+	state.BindTexture(GL_TEXTURE_2D, 0);
+	// Same again with one layer, an array sampler can't read the 2D one
+	glGenTextures(1, &_placeholderArrayID);
+	state.BindTexture(GL_TEXTURE_2D_ARRAY, _placeholderArrayID);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholderPixel);
+	state.BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+/// <summary>
+/// Lets in flight decodes finish, then frees everything
+/// </summary>
+TextureManager::~TextureManager()
+{
+	Release();
+}
+
+/// <summary>
+/// Loads after this look for a baked <name>.ktx2 in the folder before decoding the source image,
+/// or <name>.flip.ktx2 for flipped loads
+/// </summary>
+void TextureManager::SetBakedDirectory(const std::string& directory)
+{
+	_bakedDirectory = directory;
+}
+
+/// <summary>
+/// Queues a texture for loading. Asking for the same file twice gives back the same handle
+/// </summary>
+/// <param name="path"> path to the image file </param>
+/// <param name="flipVertically"> flip rows on load so (0,0) is the bottom left like GL expects </param>
+/// <param name="srgb"> the image is color, store it as sRGB so sampling returns linear values. Leave off for masks and data </param>
+/// <returns> handle that can be bound right away, it shows the placeholder until the load finishes </returns>
+TextureHandle TextureManager::Load(const std::string& path, bool flipVertically, bool srgb)
+{
+	std::string key = path + (flipVertically ? "|flip" : "") + (srgb ? "|srgb" : "");
+	auto existing = _handlesByKey.find(key);
+	if (existing != _handlesByKey.end())
+	{
+		return existing->second;
+	}
+	TextureHandle handle = AddEntry(key, path, false);
+
+	std::string bakedPath;
+	if (!_bakedDirectory.empty())
+	{
+		size_t nameStart = path.find_last_of("/\\");
+		nameStart = (nameStart == std::string::npos) ? 0 : nameStart + 1;
+		size_t extension = path.find_last_of('.');
+		size_t nameLength = (extension == std::string::npos || extension < nameStart) ? std::string::npos : extension - nameStart;
+		bakedPath = _bakedDirectory + "/" + path.substr(nameStart, nameLength) + (flipVertically ? ".flip.ktx2" : ".ktx2");
+	}
+
+	_workers.Submit([this, handle, path, bakedPath, flipVertically, srgb]()
+	{
+		ProfileZone decodeZone("Texture decode");
+		DecodedImage image;
+		image.Handle = handle;
+		if (bakedPath.empty() || !LoadBaked(bakedPath, path, flipVertically, srgb, image))
+		{
+			// The flip flag is thread local so every worker has to set it for itself
+			stbi_set_flip_vertically_on_load_thread(flipVertically);
+			// Keep whatever channel count and precision the file has, the upload picks a format to match
+			const char* file = path.c_str();
+			if (stbi_is_hdr(file))
+			{
+				image.HDR = true;
+				image.Pixels = (unsigned char*)stbi_loadf(file, &image.Width, &image.Height, &image.Channels, 0);
+			}
+			else if (stbi_is_16_bit(file))
+			{
+				image.BitDepth = 16;
+				image.Pixels = (unsigned char*)stbi_load_16(file, &image.Width, &image.Height, &image.Channels, 0);
+			}
+			else
+			{
+				image.Pixels = stbi_load(file, &image.Width, &image.Height, &image.Channels, 0);
+			}
+			image.SRGB = srgb;
+		}
+		QueueDecoded(image);
+	});
+	return handle;
+}
+
+/// <summary>
+/// Queues equally sized images for loading as the layers of one array texture. Asking for the same list twice gives
+/// back the same handle
+/// </summary>
+/// <returns> handle that can be bound right away (to a sampler2DArray), it shows the placeholder until the load finishes </returns>
+TextureHandle TextureManager::LoadArray(const std::vector<std::string>& layerPaths, bool flipVertically, bool srgb)
+{
+	std::string paths;
+	for (const std::string& path : layerPaths)
+	{
+		paths += (paths.empty() ? "" : ";") + path;
+	}
+	std::string key = "array:" + paths + (flipVertically ? "|flip" : "") + (srgb ? "|srgb" : "");
+	auto existing = _handlesByKey.find(key);
+	if (existing != _handlesByKey.end())
+	{
+		return existing->second;
+	}
+	TextureHandle handle = AddEntry(key, paths, true);
+
+	_workers.Submit([this, handle, layerPaths, flipVertically, srgb]()
+	{
+		ProfileZone decodeZone("Texture decode");
+		DecodedImage image;
+		image.Handle = handle;
+		image.Array = true;
+		image.SRGB = srgb;
+		stbi_set_flip_vertically_on_load_thread(flipVertically);
+		DecodeArray(layerPaths, image);
+		QueueDecoded(image);
+	});
+	return handle;
+}
+
+TextureHandle TextureManager::AddEntry(const std::string& key, const std::string& path, bool isArray)
+{
+	TextureEntry entry;
+	entry.Path = path;
+	entry.Array = isArray;
+	_textures.push_back(entry);
+	TextureHandle handle = (TextureHandle)_textures.size();
+	_handlesByKey[key] = handle;
+	_pendingCount++;
+	return handle;
+}
+
+/// <summary>
+/// Decodes every layer into one block of pixels. Runs on a worker
+/// </summary>
+/// <returns> false if a layer could not be read or is not the size of the first, image.Pixels is left null </returns>
+bool TextureManager::DecodeArray(const std::vector<std::string>& layerPaths, DecodedImage& image)
+{
+	image.Layers = (int)layerPaths.size();
+	size_t layerBytes = 0;
+	for (size_t layer = 0; layer < layerPaths.size(); layer++)
+	{
+		int width = 0;
+		int height = 0;
+		int fileChannels = 0;
+		// Later layers are converted to the first one's channel count so they all fit one format
+		unsigned char* pixels = stbi_load(layerPaths[layer].c_str(), &width, &height, &fileChannels, layer == 0 ? 0 : image.Channels);
+		if (!pixels)
+		{
+			std::cout << "ERROR::TEXTURE::ARRAY_LAYER_NOT_LOADED " << layerPaths[layer] << std::endl;
+			FreePixels(image);
+			return false;
+		}
+		if (layer == 0)
+		{
+			image.Width = width;
+			image.Height = height;
+			image.Channels = fileChannels;
+			layerBytes = (size_t)width * (size_t)height * (size_t)fileChannels;
+			// stbi_image_free is free(), so FreePixels releases this like any decoded image
+			image.Pixels = (unsigned char*)malloc(layerBytes * layerPaths.size());
+		}
+		else if (width != image.Width || height != image.Height)
+		{
+			std::cout << "ERROR::TEXTURE::ARRAY_LAYER_SIZE_MISMATCH " << layerPaths[layer] << " is " << width << "x" << height
+				<< ", layer 0 is " << image.Width << "x" << image.Height << std::endl;
+			stbi_image_free(pixels);
+			FreePixels(image);
+			return false;
+		}
+		memcpy(image.Pixels + layer * layerBytes, pixels, layerBytes);
+		stbi_image_free(pixels);
+	}
+	return true;
+}
+
+/// <summary>
+/// Hands a decoded image to Update, copying it into the staging ring when there is room. Runs on a worker
+/// </summary>
+void TextureManager::QueueDecoded(DecodedImage& image)
+{
+	// Ring space is allocated under the same lock as the push so the queue stays in allocation order
+	std::unique_lock<std::mutex> lock(_decodedMutex);
+	image.Staged = image.Data() && _staging.Allocate(image.ByteSize(), image.Staging);
+	image.Copied = !image.Staged;
+	_decoded.push_back(image);
+	if (!image.Staged)
+	{
+		return;
+	}
+	// References into a deque survive push_back, and Update never pops an image that is not Copied
+	DecodedImage& queued = _decoded.back();
+	lock.unlock();
+
+	// For baked images this is the only copy, straight from the mapped file into the ring
+	memcpy(image.Staging.Memory, image.Data(), image.ByteSize());
+	FreePixels(image);
+
+	lock.lock();
+	queued.Pixels = nullptr;
+	queued.Mapping.reset();
+	queued.Copied = true;
+}
+
+/// <summary>
+/// Sets how many bytes Update may upload per call
+/// </summary>
+void TextureManager::SetUploadBudget(size_t bytesPerFrame)
+{
+	_uploadBudget = bytesPerFrame;
+}
+
+/// <summary>
+/// Call once per frame on the GL thread, uploads finished images in order until the budget is used up
+/// </summary>
+void TextureManager::Update()
+{
+	ProfileZone uploadZone("Texture upload");
+	_staging.Reclaim();
+
+	std::vector<DecodedImage> ready;
+	{
+		std::lock_guard<std::mutex> lock(_decodedMutex);
+		size_t budgetUsed = 0;
+		while (!_decoded.empty() && _decoded.front().Copied)
+		{
+			size_t bytes = _decoded.front().ByteSize();
+			if (!ready.empty() && budgetUsed + bytes > _uploadBudget)
+			{
+				break;
+			}
+			budgetUsed += bytes;
+			ready.push_back(_decoded.front());
+			_decoded.pop_front();
+		}
+	}
+
+	unsigned long long stagedEnd = 0;
+	for (DecodedImage& image : ready)
+	{
+		Upload(image);
+		if (image.Staged)
+		{
+			stagedEnd = image.Staging.End;
+		}
+		FreePixels(image);
+		_pendingCount--;
+	}
+
+	// One fence covers every staged upload of this frame
+	if (stagedEnd != 0)
+	{
+		_staging.Fence(stagedEnd);
+	}
+}
+
+/// <summary>
+/// Blocks until every queued texture is decoded and uploaded, ignores the upload budget
+/// </summary>
+void TextureManager::WaitAll()
+{
+	_workers.WaitIdle();
+	size_t budget = _uploadBudget;
+	_uploadBudget = (size_t)-1;
+	Update();
+	_uploadBudget = budget;
+}
+
+/// <summary>
+/// Waits for the workers and deletes every texture. Call it while the GL context is still current,
+/// the destructor calls it too but by then the context may already be gone
+/// </summary>
+void TextureManager::Release()
+{
+	_workers.WaitIdle();
+	{
+		std::lock_guard<std::mutex> lock(_decodedMutex);
+		for (DecodedImage& image : _decoded)
+		{
+			FreePixels(image);
+		}
+		_decoded.clear();
+	}
+	_staging.Destroy();
+
+	for (TextureEntry& entry : _textures)
+	{
+		if (entry.ID != 0)
+		{
+			GLStateCache::Instance().DeleteTexture(entry.ID);
+			entry.ID = 0;
+		}
+		entry.Ready = false;
+	}
+	if (_placeholderID != 0)
+	{
+		GLStateCache::Instance().DeleteTexture(_placeholderID);
+		_placeholderID = 0;
+	}
+	if (_placeholderArrayID != 0)
+	{
+		GLStateCache::Instance().DeleteTexture(_placeholderArrayID);
+		_placeholderArrayID = 0;
+	}
+	_pendingCount = 0;
+}
+
+/// <summary>
+/// Binds the texture (or the placeholder) to a texture unit
+/// </summary>
+/// <param name="handle"> texture to bind </param>
+/// <param name="unit"> texture unit index, 0 for GL_TEXTURE0 </param>
+void TextureManager::Bind(TextureHandle handle, unsigned int unit) const
+{
+	GLStateCache::Instance().BindTexture(unit, GetTextureTarget(handle), GetTextureID(handle));
+}
+
+/// <summary>
+/// GL name to sample from, the placeholder until the texture is ready
+/// </summary>
+unsigned int TextureManager::GetTextureID(TextureHandle handle) const
+{
+	if (IsReady(handle))
+	{
+		return _textures[handle - 1].ID;
+	}
+	return GetTextureTarget(handle) == GL_TEXTURE_2D_ARRAY ? _placeholderArrayID : _placeholderID;
+}
+
+unsigned int TextureManager::GetTextureTarget(TextureHandle handle) const
+{
+	bool isArray = handle != InvalidTextureHandle && handle <= _textures.size() && _textures[handle - 1].Array;
+	return isArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+}
+
+bool TextureManager::IsReady(TextureHandle handle) const
+{
+	return handle != InvalidTextureHandle && handle <= _textures.size() && _textures[handle - 1].Ready;
+}
+
+size_t TextureManager::PendingCount() const
+{
+	return _pendingCount;
+}
+
+/// <summary>
+/// Maps a baked KTX2 file, nothing is read until the levels are copied or uploaded. Runs on a worker
+/// </summary>
+/// <param name="sourcePath"> the image it was baked from, a newer source means the bake is stale </param>
+/// <param name="flipVertically"> what Load asked for, the bake's orientation has to match </param>
+/// <param name="srgb"> what Load asked for, the bake has to have been written the same way </param>
+/// <returns> false if the file is missing, stale, broken or in a format the driver can't sample, the caller decodes the source instead </returns>
+bool TextureManager::LoadBaked(const std::string& path, const std::string& sourcePath, bool flipVertically, bool srgb,
+	DecodedImage& image)
+{
+	// The bake directory isn't checked in, so after editing an image the old bake would otherwise keep winning
+	std::error_code error;
+	std::filesystem::file_time_type bakedTime = std::filesystem::last_write_time(path, error);
+	if (error)
+	{
+		return false;
+	}
+	std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(sourcePath, error);
+	if (!error && sourceTime > bakedTime)
+	{
+		std::cout << "Baked texture " << path << " is older than " << sourcePath << ", decoding the source instead" << std::endl;
+		return false;
+	}
+
+	std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>();
+	if (!mapping->Open(path))
+	{
+		return false;
+	}
+
+	KTX2Info info;
+	if (!ParseKTX2(mapping->Data(), mapping->Size(), info))
+	{
+		return false;
+	}
+	if (info.BottomToTop != flipVertically)
+	{
+		std::cout << "Baked texture " << path << (flipVertically ? " is not" : " is") << " flipped, decoding the source instead" << std::endl;
+		return false;
+	}
+	if (KTX2IsSRGB(info.VkFormat) != srgb)
+	{
+		std::cout << "Baked texture " << path << (srgb ? " is not" : " is") << " sRGB, decoding the source instead" << std::endl;
+		return false;
+	}
+	GLenum format = CompressedInternalFormat(info.VkFormat);
+	if (format == 0)
+	{
+		std::cout << "Baked texture " << path << " is not supported by this driver, decoding the source instead" << std::endl;
+		return false;
+	}
+
+	image.Mapping = mapping;
+	image.Width = info.Width;
+	image.Height = info.Height;
+	image.CompressedFormat = format;
+	image.CompressedBytes = mapping->Size();
+	for (const KTX2Level& level : info.Levels)
+	{
+		image.Levels.push_back({ level.Offset, level.Size, level.Width, level.Height });
+	}
+	return true;
+}
+
+/// <summary>
+/// Frees the decoded pixels or drops the file mapping
+/// </summary>
+void TextureManager::FreePixels(DecodedImage& image)
+{
+	stbi_image_free(image.Pixels);
+	image.Pixels = nullptr;
+	image.Mapping.reset();
+}
+
+/// <summary>
+/// Creates the GL texture for a decoded image
+/// </summary>
+void TextureManager::Upload(const DecodedImage& image)
+{
+	TextureEntry& entry = _textures[image.Handle - 1];
+	if (!image.Data() && !image.Staged)
+	{
+		// Keep showing the placeholder
+		std::cout << "Fail to load texture " << entry.Path << std::endl;
+		return;
+	}
+
+	GLStateCache& state = GLStateCache::Instance();
+	GLenum target = image.Array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+	glGenTextures(1, &entry.ID);
+	state.BindTexture(target, entry.ID);
+	// Set Wrapping setings for the S and T axis (texture coords are in STR instead of XYZ)
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// Set Texture filtering for magnifying and minifying
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// Data comes either from client memory or, when the unpack buffer is bound, from an offset into it
+	const unsigned char* source = image.Data();
+	if (image.Staged)
+	{
+		// Already in the ring
+		state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, _staging.GetBufferID());
+		source = (const unsigned char*)image.Staging.Offset;
+	}
+	else if (!_staging.IsPersistent() && _staging.GetBufferID() != 0)
+	{
+		// No persistent mapping, copy into freshly orphaned storage so the driver never has to wait on the GPU
+		unsigned char* staging = _staging.Orphan(image.ByteSize());
+		if (staging)
+		{
+			memcpy(staging, image.Data(), image.ByteSize());
+			_staging.Unmap();
+			source = nullptr;
+		}
+		else
+		{
+			state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+	}
+	// Otherwise the ring was full when it was decoded, upload from client memory (for baked images the mapped file)
+
+	if (image.CompressedFormat != 0)
+	{
+		// The mip chain was baked offline, no glGenerateMipmap
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.Levels.size() - 1);
+		for (size_t level = 0; level < image.Levels.size(); level++)
+		{
+			const CompressedLevel& mip = image.Levels[level];
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, image.CompressedFormat, mip.Width, mip.Height, 0,
+				(GLsizei)mip.Size, source + mip.Offset);
+		}
+	}
+	else
+	{
+		PixelFormat format = SelectPixelFormat(image.Channels, image.BitDepth, image.SRGB, image.HDR);
+		SetUnpackAlignment((size_t)image.Width * (size_t)format.BytesPerPixel);
+		if (image.Array)
+		{
+			glTexImage3D(target, 0, format.InternalFormat, image.Width, image.Height, image.Layers, 0, format.Format, format.Type, source);
+		}
+		else
+		{
+			glTexImage2D(target, 0, format.InternalFormat, image.Width, image.Height, 0, format.Format, format.Type, source);
+		}
+		ApplyChannelSwizzle(image.Channels, target);
+		glGenerateMipmap(target);
+	}
+	state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	state.BindTexture(target, 0);
+	Profiler::Instance().CountUploadBytes(image.ByteSize());
+
+	entry.Ready = true;
+}
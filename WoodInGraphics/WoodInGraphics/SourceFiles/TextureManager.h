@@ -0,0 +1,154 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Loads textures in the background. Image decoding runs on a worker pool, the GL upload happens
+/// on the main thread in Update. Handles are valid straight away and show a placeholder until the real texture is in.
+/// Workers copy decoded pixels straight into a persistently mapped staging ring so the upload is an async PBO copy,
+/// and Update only uploads up to a byte budget per frame so a burst of loads does not cause a hitch.
+/// Images keep the channel count and bit depth of the file, see TextureFormat.h for the GL format picked.
+/// With a baked directory set, KTX2 files written by wig-texbake are used in place of the source images,
+/// those are memory mapped and their block compressed mip chain goes to GL as is, never through the heap.
+/// LoadArray stacks equally sized images into one GL_TEXTURE_2D_ARRAY, so draws that pick an image per instance or
+/// per object sample one texture by layer instead of switching textures. Array layers always decode the sources.
+/// -----------------
+
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#pragma region Includes
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MappedFile.h"
+#include "StagingRing.h"
+#include "ThreadPool.h"
+
+#pragma endregion Includes
+
+// 0 is never handed out, so it can be used as "no texture"
+typedef unsigned int TextureHandle;
+const TextureHandle InvalidTextureHandle = 0;
+
+const size_t DefaultStagingBytes = 32 * 1024 * 1024;
+const size_t DefaultUploadBudgetBytes = 8 * 1024 * 1024;
+
+class TextureManager
+{
+public:
+
+	explicit TextureManager(unsigned int workerCount = 0, size_t stagingBytes = DefaultStagingBytes);
+	~TextureManager();
+
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	TextureHandle Load(const std::string& path, bool flipVertically = false, bool srgb = false);
+	// Layer i is layerPaths[i]. Every image has to be the same size, they are stored with the first one's channel count
+	TextureHandle LoadArray(const std::vector<std::string>& layerPaths, bool flipVertically = false, bool srgb = false);
+
+	// Folder holding <name>.ktx2 (and <name>.flip.ktx2 for flipped loads) baked from the source images, empty to always
+	// decode the source. A bake older than its source, or baked sRGB or flipped when Load didn't ask for it (or the
+	// other way round), is skipped
+	void SetBakedDirectory(const std::string& directory);
+
+	void Update();
+	void WaitAll();
+	void Release();
+
+	// Bytes uploaded per Update, at least one texture is always uploaded so a big one can't get stuck
+	void SetUploadBudget(size_t bytesPerFrame);
+
+	void Bind(TextureHandle handle, unsigned int unit) const;
+	unsigned int GetTextureID(TextureHandle handle) const;
+	// GL_TEXTURE_2D, or GL_TEXTURE_2D_ARRAY for LoadArray handles (placeholder included)
+	unsigned int GetTextureTarget(TextureHandle handle) const;
+	bool IsReady(TextureHandle handle) const;
+	size_t PendingCount() const;
+
+private:
+
+	// Mip level of a compressed image, Offset is from the start of the file
+	struct CompressedLevel
+	{
+		size_t Offset = 0;
+		size_t Size = 0;
+		int Width = 0;
+		int Height = 0;
+	};
+
+	struct TextureEntry
+	{
+		std::string Path;
+		unsigned int ID = 0;
+		bool Ready = false;
+		bool Array = false;
+	};
+
+	// Written by the workers, picked up by Update
+	struct DecodedImage
+	{
+		TextureHandle Handle = InvalidTextureHandle;
+		unsigned char* Pixels = nullptr;
+		int Width = 0;
+		int Height = 0;
+		int Channels = 0;
+		// 8 or 16 bit integer channels, or 32 bit float when HDR
+		int BitDepth = 8;
+		bool HDR = false;
+		bool SRGB = false;
+		// Array textures: Layers images of Width x Height back to back in Pixels
+		int Layers = 1;
+		bool Array = false;
+
+		// Baked images: the KTX2 file stays mapped until it is uploaded, level offsets are into the file
+		std::shared_ptr<MappedFile> Mapping;
+		unsigned int CompressedFormat = 0;
+		size_t CompressedBytes = 0;
+		std::vector<CompressedLevel> Levels;
+
+		// Staged images live in the staging ring instead of Pixels
+		StagingAllocation Staging;
+		bool Staged = false;
+		// False while a worker is still copying into the staging ring
+		bool Copied = false;
+
+		const unsigned char* Data() const { return Mapping ? Mapping->Data() : Pixels; }
+		size_t ByteSize() const
+		{
+			size_t bytesPerChannel = HDR ? sizeof(float) : (size_t)BitDepth / 8;
+			return CompressedFormat != 0 ? CompressedBytes : (size_t)Width * (size_t)Height * (size_t)Layers * (size_t)Channels * bytesPerChannel;
+		}
+	};
+
+	// Index is handle - 1
+	std::vector<TextureEntry> _textures;
+	std::unordered_map<std::string, TextureHandle> _handlesByKey;
+	size_t _pendingCount = 0;
+	size_t _uploadBudget = DefaultUploadBudgetBytes;
+	unsigned int _placeholderID = 0;
+	unsigned int _placeholderArrayID = 0;
+	std::string _bakedDirectory;
+
+	// Staged images are pushed in the same order their ring space was allocated, Update has to keep that order
+	std::mutex _decodedMutex;
+	std::deque<DecodedImage> _decoded;
+	StagingRing _staging;
+
+	// Declared last so the workers are joined before anything they write to is destroyed
+	ThreadPool _workers;
+
+	static bool LoadBaked(const std::string& path, const std::string& sourcePath, bool flipVertically, bool srgb,
+		DecodedImage& image);
+	static void FreePixels(DecodedImage& image);
+	TextureHandle AddEntry(const std::string& key, const std::string& path, bool isArray);
+	void QueueDecoded(DecodedImage& image);
+	static bool DecodeArray(const std::vector<std::string>& layerPaths, DecodedImage& image);
+	void Upload(const DecodedImage& image);
+};
+
+#endif // !TEXTURE_MANAGER_H
@@ -0,0 +1,94 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Fixed size worker pool, jobs run in submission order on whichever worker is free
+/// -----------------
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+/// <summary>
+/// Starts the workers
+/// </summary>
+/// <param name="threadCount"> number of workers, 0 uses one per hardware thread </param>
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	_threads.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		_threads.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+/// <summary>
+/// Runs every queued job and then joins the workers
+/// </summary>
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_jobAvailable.notify_all();
+	for (std::thread& thread : _threads)
+	{
+		thread.join();
+	}
+}
+
+/// <summary>
+/// Queues a job, it must not use GL since the workers have no context
+/// </summary>
+void ThreadPool::Submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push_back(std::move(job));
+	}
+	_jobAvailable.notify_one();
+}
+
+/// <summary>
+/// Blocks until the queue is empty and no job is running
+/// </summary>
+void ThreadPool::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idle.wait(lock, [this]() { return _jobs.empty() && _activeJobs == 0; });
+}
+
+unsigned int ThreadPool::ThreadCount() const
+{
+	return (unsigned int)_threads.size();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		_jobAvailable.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+		if (_jobs.empty())
+		{
+			// Only reached when stopping and everything queued has run
+			return;
+		}
+
+		std::function<void()> job = std::move(_jobs.front());
+		_jobs.pop_front();
+		_activeJobs++;
+
+		lock.unlock();
+		job();
+		lock.lock();
+
+		_activeJobs--;
+		if (_jobs.empty() && _activeJobs == 0)
+		{
+			_idle.notify_all();
+		}
+	}
+}
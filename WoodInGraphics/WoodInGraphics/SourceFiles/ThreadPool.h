@@ -0,0 +1,49 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Small fixed size worker pool for CPU work that does not touch GL (decoding, parsing, building draw lists)
+/// -----------------
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#pragma region Includes
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#pragma endregion Includes
+
+class ThreadPool
+{
+public:
+
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Submit(std::function<void()> job);
+	void WaitIdle();
+
+	unsigned int ThreadCount() const;
+
+private:
+
+	std::vector<std::thread> _threads;
+	std::deque<std::function<void()>> _jobs;
+	std::mutex _mutex;
+	std::condition_variable _jobAvailable;
+	std::condition_variable _idle;
+	unsigned int _activeJobs = 0;
+	bool _stopping = false;
+
+	void WorkerLoop();
+};
+
+#endif // !THREAD_POOL_H
@@ -0,0 +1,121 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: C++ mirrors of the GLSL uniform blocks, checked against the std140 rules at compile time.
+/// Std140Layout<Types...> works out where std140 puts each member of a block declared with those GLSL types,
+/// STD140_MEMBER static_asserts that the C++ struct has the member at that offset and STD140_SIZE that the struct
+/// is the block's size, so a whole block can be written with one memcpy. The usual catch is glm::vec3, which C++
+/// aligns to 4 but std140 aligns to 16, so anything after a float needs explicit padding before it; the asserts say
+/// where. Arrays use a 16 byte stride in std140, so arrays of scalars are best declared as glm::vec4 in both.
+/// Every program's block of the same name goes on the same binding point (Shader::BindUniformBlock), so one
+/// glBindBufferRange serves every program that reads it.
+/// -----------------
+
+#ifndef UNIFORM_BLOCK_H
+#define UNIFORM_BLOCK_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#pragma endregion Includes
+
+#pragma region Std140
+
+// Base alignment and size of a GLSL type under std140. Types without a rule here (bool, mat3, nested structs) fail
+// to compile rather than getting a wrong layout
+template<class T> struct Std140Traits;
+
+template<> struct Std140Traits<float> { static constexpr size_t Alignment = 4; static constexpr size_t Size = 4; };
+template<> struct Std140Traits<int32_t> { static constexpr size_t Alignment = 4; static constexpr size_t Size = 4; };
+template<> struct Std140Traits<uint32_t> { static constexpr size_t Alignment = 4; static constexpr size_t Size = 4; };
+template<> struct Std140Traits<glm::vec2> { static constexpr size_t Alignment = 8; static constexpr size_t Size = 8; };
+template<> struct Std140Traits<glm::ivec2> { static constexpr size_t Alignment = 8; static constexpr size_t Size = 8; };
+template<> struct Std140Traits<glm::vec3> { static constexpr size_t Alignment = 16; static constexpr size_t Size = 12; };
+template<> struct Std140Traits<glm::vec4> { static constexpr size_t Alignment = 16; static constexpr size_t Size = 16; };
+template<> struct Std140Traits<glm::ivec4> { static constexpr size_t Alignment = 16; static constexpr size_t Size = 16; };
+// Four vec4 columns
+template<> struct Std140Traits<glm::mat4> { static constexpr size_t Alignment = 16; static constexpr size_t Size = 64; };
+
+constexpr size_t Std140AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// Array elements are rounded up to a vec4 each
+template<class T, size_t N> struct Std140Traits<T[N]>
+{
+	static constexpr size_t Alignment = 16;
+	static constexpr size_t Size = Std140AlignUp(Std140Traits<T>::Size, 16) * N;
+};
+
+/// <summary>
+/// Offsets of a block's members, given their GLSL types in declaration order
+/// </summary>
+template<class... Members>
+struct Std140Layout
+{
+	static constexpr size_t Count = sizeof...(Members);
+	static constexpr size_t Alignments[] = { Std140Traits<Members>::Alignment... };
+	static constexpr size_t Sizes[] = { Std140Traits<Members>::Size... };
+
+	static constexpr size_t Offset(size_t index)
+	{
+		size_t offset = 0;
+		for (size_t i = 0; i < index; i++)
+		{
+			offset = Std140AlignUp(offset, Alignments[i]) + Sizes[i];
+		}
+		return Std140AlignUp(offset, Alignments[index]);
+	}
+
+	// Whole block rounded to a vec4, what glBindBufferRange should cover
+	static constexpr size_t Size = Std140AlignUp(Offset(Count - 1) + Sizes[Count - 1], 16);
+};
+
+#define STD140_MEMBER(Struct, Layout, Index, Member) \
+	static_assert(offsetof(Struct, Member) == Layout::Offset(Index), #Struct "::" #Member " is not at its std140 offset")
+
+#define STD140_SIZE(Struct, Layout) \
+	static_assert(sizeof(Struct) == Layout::Size, #Struct " is not its std140 block size, pad the end")
+
+#pragma endregion Std140
+
+#pragma region Blocks
+
+const unsigned int UniformBindingFrame = 0;
+const unsigned int UniformBindingMaterial = 1;
+
+// uniform Frame, written once a frame and read by every program
+struct FrameUniforms
+{
+	glm::mat4 ViewProjection = glm::mat4(1.0f);
+	glm::vec2 Resolution = glm::vec2(0.0f);
+	float Time = 0.0f;
+	float DeltaTime = 0.0f;
+};
+using FrameUniformsLayout = Std140Layout<glm::mat4, glm::vec2, float, float>;
+STD140_MEMBER(FrameUniforms, FrameUniformsLayout, 0, ViewProjection);
+STD140_MEMBER(FrameUniforms, FrameUniformsLayout, 1, Resolution);
+STD140_MEMBER(FrameUniforms, FrameUniformsLayout, 2, Time);
+STD140_MEMBER(FrameUniforms, FrameUniformsLayout, 3, DeltaTime);
+STD140_SIZE(FrameUniforms, FrameUniformsLayout);
+
+// uniform Material, per material values of the base shader
+struct MaterialUniforms
+{
+	glm::vec4 Tint = glm::vec4(1.0f);
+	float ArrowAlpha = 0.0f;
+	float Padding[3] = {};
+};
+using MaterialUniformsLayout = Std140Layout<glm::vec4, float>;
+STD140_MEMBER(MaterialUniforms, MaterialUniformsLayout, 0, Tint);
+STD140_MEMBER(MaterialUniforms, MaterialUniformsLayout, 1, ArrowAlpha);
+STD140_SIZE(MaterialUniforms, MaterialUniformsLayout);
+
+#pragma endregion Blocks
+
+#endif // !UNIFORM_BLOCK_H
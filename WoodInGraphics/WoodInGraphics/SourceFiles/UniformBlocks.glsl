@@ -0,0 +1,18 @@
+// Uniform blocks shared between shaders, mirrors UniformBlock.h. Included once per shader however often it is
+// included, blocks a stage does not use are simply inactive
+
+// Written once a frame and read by every program
+layout (std140) uniform Frame
+{
+	mat4 viewProjection;
+	vec2 resolution;
+	float time;
+	float deltaTime;
+};
+
+// Per material values of the base shader
+layout (std140) uniform Material
+{
+	vec4 tint;
+	float arrowAlpha;
+};
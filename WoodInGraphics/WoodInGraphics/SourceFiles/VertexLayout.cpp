@@ -0,0 +1,212 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Vertex layout descriptors and quantized attribute encoding
+/// -----------------
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <glm/gtc/packing.hpp>
+
+#include "VertexLayout.h"
+
+/// <summary>
+/// Bytes a single stored component of the type takes
+/// </summary>
+static size_t ComponentBytes(VertexType type)
+{
+	switch (type)
+	{
+	case VertexType::Float:
+		return 4;
+	case VertexType::UNorm8:
+	case VertexType::SNorm8:
+		return 1;
+	default:
+		return 2;
+	}
+}
+
+static unsigned int GLType(VertexType type)
+{
+	switch (type)
+	{
+	case VertexType::Float:
+		return GL_FLOAT;
+	case VertexType::Half:
+		return GL_HALF_FLOAT;
+	case VertexType::UNorm8:
+		return GL_UNSIGNED_BYTE;
+	case VertexType::SNorm8:
+		return GL_BYTE;
+	case VertexType::UNorm16:
+		return GL_UNSIGNED_SHORT;
+	default:
+		return GL_SHORT;
+	}
+}
+
+/// <summary>
+/// Appends an element after the last one
+/// </summary>
+/// <param name="location"> shader input location </param>
+/// <param name="components"> 1 to 4, must be 3 for Octahedral </param>
+VertexLayout& VertexLayout::Add(unsigned int location, VertexType type, int components)
+{
+	if (components < 1 || components > 4 || (type == VertexType::Octahedral && components != 3))
+	{
+		std::cout << "ERROR::VERTEX_LAYOUT::BAD_COMPONENT_COUNT " << components << std::endl;
+		return *this;
+	}
+	int stored = type == VertexType::Octahedral ? 2 : components;
+	size_t bytes = stored * ComponentBytes(type);
+
+	VertexElement element = { location, type, components, _stride };
+	_elements.push_back(element);
+	// Integer types go to the shader normalized, floats and halves as they are
+	bool normalized = type != VertexType::Float && type != VertexType::Half;
+	_attributes.push_back({ location, stored, GLType(type), normalized, _stride });
+	_stride += (bytes + 3) & ~(size_t)3;
+	_sourceFloats += components;
+	return *this;
+}
+
+size_t VertexLayout::GetStride() const
+{
+	return _stride;
+}
+
+unsigned int VertexLayout::GetElementCount() const
+{
+	return (unsigned int)_elements.size();
+}
+
+const VertexElement& VertexLayout::GetElement(unsigned int index) const
+{
+	return _elements[index];
+}
+
+const VertexAttribute* VertexLayout::GetAttributes() const
+{
+	return _attributes.data();
+}
+
+unsigned int VertexLayout::GetSourceFloats() const
+{
+	return _sourceFloats;
+}
+
+void VertexLayout::Apply() const
+{
+	for (const VertexAttribute& attribute : _attributes)
+	{
+		glVertexAttribPointer(attribute.Location, attribute.Components, attribute.Type, attribute.Normalized ? GL_TRUE : GL_FALSE,
+			(GLsizei)_stride, (void*)attribute.Offset);
+		glEnableVertexAttribArray(attribute.Location);
+	}
+}
+
+/// <summary>
+/// Quantizes one element into its slot in the vertex
+/// </summary>
+/// <param name="vertex"> start of the vertex, GetStride bytes </param>
+void VertexLayout::Write(unsigned char* vertex, unsigned int element, const float* values) const
+{
+	const VertexElement& description = _elements[element];
+	unsigned char* out = vertex + description.Offset;
+	uint16_t packed[4];
+	switch (description.Type)
+	{
+	case VertexType::Float:
+		memcpy(out, values, description.Components * sizeof(float));
+		return;
+	case VertexType::Half:
+		for (int i = 0; i < description.Components; i++)
+		{
+			packed[i] = glm::packHalf1x16(values[i]);
+		}
+		break;
+	case VertexType::UNorm8:
+		for (int i = 0; i < description.Components; i++)
+		{
+			out[i] = glm::packUnorm1x8(values[i]);
+		}
+		return;
+	case VertexType::SNorm8:
+		for (int i = 0; i < description.Components; i++)
+		{
+			out[i] = glm::packSnorm1x8(values[i]);
+		}
+		return;
+	case VertexType::UNorm16:
+		for (int i = 0; i < description.Components; i++)
+		{
+			packed[i] = glm::packUnorm1x16(values[i]);
+		}
+		break;
+	case VertexType::SNorm16:
+		for (int i = 0; i < description.Components; i++)
+		{
+			packed[i] = glm::packSnorm1x16(values[i]);
+		}
+		break;
+	case VertexType::Octahedral:
+	{
+		glm::vec2 encoded = EncodeOctahedral(glm::vec3(values[0], values[1], values[2]));
+		packed[0] = glm::packSnorm1x16(encoded.x);
+		packed[1] = glm::packSnorm1x16(encoded.y);
+		memcpy(out, packed, 2 * sizeof(uint16_t));
+		return;
+	}
+	}
+	memcpy(out, packed, description.Components * sizeof(uint16_t));
+}
+
+/// <summary>
+/// Encodes a whole float vertex array into this layout
+/// </summary>
+/// <param name="source"> vertexCount * GetSourceFloats floats </param>
+std::vector<unsigned char> VertexLayout::Encode(const float* source, size_t vertexCount) const
+{
+	// Zeroed so the padding bytes are deterministic
+	std::vector<unsigned char> encoded(vertexCount * _stride, 0);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		const float* values = source + vertex * _sourceFloats;
+		unsigned char* out = encoded.data() + vertex * _stride;
+		for (unsigned int element = 0; element < _elements.size(); element++)
+		{
+			Write(out, element, values);
+			values += _elements[element].Components;
+		}
+	}
+	return encoded;
+}
+
+glm::vec2 EncodeOctahedral(const glm::vec3& normal)
+{
+	glm::vec3 n = normal / (glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z));
+	glm::vec2 encoded(n.x, n.y);
+	if (n.z < 0.0f)
+	{
+		// Lower half folds over the diagonals into the corners
+		glm::vec2 signs(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+		encoded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signs;
+	}
+	return encoded;
+}
+
+glm::vec3 DecodeOctahedral(const glm::vec2& encoded)
+{
+	glm::vec3 n(encoded.x, encoded.y, 1.0f - glm::abs(encoded.x) - glm::abs(encoded.y));
+	if (n.z < 0.0f)
+	{
+		glm::vec2 signs(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+		glm::vec2 folded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signs;
+		n.x = folded.x;
+		n.y = folded.y;
+	}
+	return glm::normalize(n);
+}
@@ -0,0 +1,88 @@
+#pragma once
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: Describes an interleaved vertex as a list of elements, each a shader location, a storage type and a
+/// component count, and derives the offsets, the stride and the glVertexAttribPointer calls from that.
+/// Storing attributes smaller than 32 bit floats cuts vertex memory and fetch bandwidth, the shader still sees floats:
+///   Half        16 bit floats, positions and anything else that needs range
+///   UNorm8/16   [0, 1] as 8 or 16 bit integers, colors and texture coordinates
+///   SNorm8/16   [-1, 1] the same way, tangents and signed data
+///   Octahedral  a unit vector folded onto a square (two snorm16), normals in 4 bytes instead of 12
+/// The rectangle's position, color and uv go from 32 bytes as floats to 16 as Half3, UNorm8x3, UNorm16x2.
+/// Octahedral normals arrive in the shader as a vec2 and need unfolding:
+///   vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+///   if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * sign(n.xy);
+///   n = normalize(n);
+/// -----------------
+
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#pragma region Includes
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "InstancedMesh.h"
+
+#pragma endregion Includes
+
+enum class VertexType
+{
+	Float,
+	Half,
+	UNorm8,
+	SNorm8,
+	UNorm16,
+	SNorm16,
+	// Takes three components in, stores two
+	Octahedral
+};
+
+struct VertexElement
+{
+	unsigned int Location;
+	VertexType Type;
+	// Values per vertex going in, 1 to 4
+	int Components;
+	size_t Offset;
+};
+
+class VertexLayout
+{
+public:
+
+	// Appends an element, offsets stay 4 byte aligned so small elements are padded out
+	VertexLayout& Add(unsigned int location, VertexType type, int components);
+
+	size_t GetStride() const;
+	unsigned int GetElementCount() const;
+	const VertexElement& GetElement(unsigned int index) const;
+	// For InstancedMesh::Create and MeshBatch::Create
+	const VertexAttribute* GetAttributes() const;
+
+	// Sets and enables every element's pointer for the bound vertex array and GL_ARRAY_BUFFER. GL thread only
+	void Apply() const;
+
+	// Encodes one element of one vertex, values holds the element's Components floats
+	void Write(unsigned char* vertex, unsigned int element, const float* values) const;
+	// Encodes vertices given as interleaved floats, each element's Components in order, e.g. 8 floats for pos, color, uv
+	std::vector<unsigned char> Encode(const float* source, size_t vertexCount) const;
+	// Floats per vertex Encode expects
+	unsigned int GetSourceFloats() const;
+
+private:
+
+	std::vector<VertexElement> _elements;
+	std::vector<VertexAttribute> _attributes;
+	size_t _stride = 0;
+	unsigned int _sourceFloats = 0;
+};
+
+// Folds a unit vector onto [-1, 1]^2, and back
+glm::vec2 EncodeOctahedral(const glm::vec3& normal);
+glm::vec3 DecodeOctahedral(const glm::vec2& encoded);
+
+#endif // !VERTEX_LAYOUT_H
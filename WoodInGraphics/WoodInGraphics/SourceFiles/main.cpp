@@ -4,17 +4,49 @@
 /// -----------------
 // GLAD must be added before GLFW
 #include <glad/glad.h>
+#ifndef WIG_NO_GLFW
 #include <GLFW/glfw3.h>
+#endif // !WIG_NO_GLFW
 
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
 
+#include "CommandBuffer.h"
+#include "DynamicRing.h"
+#include "FileWatcher.h"
+#include "GLStateCache.h"
+#include "IndexBuffer.h"
+#include "InstancedMesh.h"
+#include "MeshBatch.h"
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "Model.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
 #include "Shader.h"
-#include "stb_image.h"
+#include "ShaderCompiler.h"
+#include "ShaderVariants.h"
+#include "SpriteBatch.h"
+#include "TextureManager.h"
+#include "ThreadPool.h"
+#include "UniformBlock.h"
+#include "VertexLayout.h"
+#ifdef WIG_HEADLESS
+#include "HeadlessContext.h"
+#endif // WIG_HEADLESS
 
 #pragma region Function Declarations
+#ifndef WIG_NO_GLFW
 void FrameBufferSizeCallback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
+#endif // !WIG_NO_GLFW
 #pragma endregion Function Declarations
 
 
@@ -23,6 +55,9 @@ void processInput(GLFWwindow* window);
 const unsigned int ScreenWidth = 800;
 const unsigned int ScreenHeight = 600;
 const char WindowName[15] = "WoodInGraphics";
+const unsigned int DefaultHeadlessFrames = 600;
+// Base shader variant bits, in the order of the feature list it is created with
+const uint32_t BaseVariantBlendTexture2 = 1u << 0;
 #pragma endregion Constants
 
 
@@ -51,6 +86,8 @@ float _texCoords[] =
 };
 
 float arrowAlpha = 0.0f;
+constexpr UniformHandle FrameBlock = "Frame"_uniform;
+constexpr UniformHandle MaterialBlock = "Material"_uniform;
 
 #pragma region Extra Triangles
 //float _triangleVertices1[] =
@@ -74,89 +111,200 @@ float arrowAlpha = 0.0f;
 /// <summary>
 /// Main method
 /// </summary>
-int main()
+/// <param name="argc"> number of command line arguments </param>
+/// <param name="argv"> --headless renders offscreen without a window, --frames N sets how many headless frames to run,
+/// --trace file.json writes a Chrome trace of the whole run, --sprites N draws N sprites a frame through the sprite batch
+/// and reports its throughput, --instances N draws a grid of N rectangles with one instanced draw, --multidraw N draws
+/// N assorted polygons from one shared buffer with a multi draw indirect per material, --no-multidraw-indirect draws
+/// them one call at a time instead, --optimize-mesh N runs the mesh optimizer on a shuffled N x N grid and reports
+/// its ACMR/ATVR before and after, --import file.glb/.obj loads a model and draws it over the scene, --obj-benchmark N
+/// parses an N x N grid written as OBJ on one thread and on the thread pool and reports MB/s for both, --dynamic N
+/// rewrites N moving rectangles every frame into the dynamic ring, --no-persistent-map makes the ring use the 3.3
+/// unsynchronized map path, --record-jobs N splits the scene recording over N jobs (1 by default, all on this thread)
+/// and reports the recording and replay time </param>
+int main(int argc, char* argv[])
 {
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	bool headless = false;
+	unsigned int headlessFrames = DefaultHeadlessFrames;
+	std::string tracePath;
+	unsigned int spriteCount = 0;
+	unsigned int instanceCount = 0;
+	unsigned int multiDrawCount = 0;
+	bool multiDrawIndirect = true;
+	unsigned int optimizeGridSize = 0;
+	std::string importPath;
+	unsigned int objBenchmarkSize = 0;
+	unsigned int dynamicCount = 0;
+	bool persistentMap = true;
+	unsigned int recordJobs = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--headless") == 0)
+		{
+			headless = true;
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+		{
+			headlessFrames = (unsigned int)std::max(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			tracePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--sprites") == 0 && i + 1 < argc)
+		{
+			spriteCount = (unsigned int)std::max(0, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+		{
+			instanceCount = (unsigned int)std::max(0, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--multidraw") == 0 && i + 1 < argc)
+		{
+			multiDrawCount = (unsigned int)std::max(0, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--optimize-mesh") == 0 && i + 1 < argc)
+		{
+			optimizeGridSize = (unsigned int)std::max(0, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--import") == 0 && i + 1 < argc)
+		{
+			importPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--obj-benchmark") == 0 && i + 1 < argc)
+		{
+			objBenchmarkSize = (unsigned int)std::max(0, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--dynamic") == 0 && i + 1 < argc)
+		{
+			dynamicCount = (unsigned int)std::max(0, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--record-jobs") == 0 && i + 1 < argc)
+		{
+			recordJobs = (unsigned int)std::max(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--no-persistent-map") == 0)
+		{
+			persistentMap = false;
+		}
+		else if (strcmp(argv[i], "--no-multidraw-indirect") == 0)
+		{
+			multiDrawIndirect = false;
+		}
+	}
 
-#ifdef __APPLE__
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif __APPLE__
+	// Started before anything loads so the startup work is in the trace too
+	Profiler::Instance().SetTraceCapture(!tracePath.empty());
 
-	// Create Window
-	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, WindowName, NULL, NULL);
-	if (window == NULL)
+#ifdef WIG_NO_GLFW
+	// Nothing to open a window with, headless is the only option
+	headless = true;
+#else
+	GLFWwindow* window = NULL;
+#endif // WIG_NO_GLFW
+
+#ifdef WIG_HEADLESS
+	HeadlessContext headlessContext;
+	if (headless && !headlessContext.Create(ScreenWidth, ScreenHeight))
 	{
-		std::cout<<"Failed to create GLFW window" << std::endl;
-		glfwTerminate();
+		std::cout << "Failed to create headless context" << std::endl;
 		return -1;
 	}
-	glfwMakeContextCurrent(window);
-	// Assign resize window callback
-	glfwSetFramebufferSizeCallback(window, FrameBufferSizeCallback);
-
-	// Check Initialization of GLAD
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+#else
+	if (headless)
 	{
-		std::cout << " Failed to Initialize GLAD" << std::endl;
+		std::cout << "Headless mode is not available in this build" << std::endl;
 		return -1;
 	}
+#endif // WIG_HEADLESS
 
+#ifndef WIG_NO_GLFW
+	if (!headless)
+	{
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-	// Create Shader Object
-	Shader shaderObj("SourceFiles/BaseVertexShader.vert", "SourceFiles/BaseFragmentShader.frag");
+#ifdef __APPLE__
+		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif // __APPLE__
 
+		// Create Window
+		window = glfwCreateWindow(ScreenWidth, ScreenHeight, WindowName, NULL, NULL);
+		if (window == NULL)
+		{
+			std::cout<<"Failed to create GLFW window" << std::endl;
+			glfwTerminate();
+			return -1;
+		}
+		glfwMakeContextCurrent(window);
+		// Assign resize window callback
+		glfwSetFramebufferSizeCallback(window, FrameBufferSizeCallback);
 
-	// Generate Texture
-	unsigned int texture;
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	// Set Wrapping setings for the S and T axis (texture coords are in STR instead of XYZ)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// Set Texture filtering for magnifying and minifying
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// Load Image
-	int imgWidth, imgHeight, nrChannel;
-	unsigned char* data = stbi_load("Textures/WoodContainer.jpg", &imgWidth, &imgHeight, &nrChannel, 0);
-	if (data)
-	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, imgWidth, imgHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		// Check Initialization of GLAD
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cout << " Failed to Initialize GLAD" << std::endl;
+			return -1;
+		}
 	}
-	else
+#endif // !WIG_NO_GLFW
+
+
+	// Create Shader Object
+	// Submitted up front and compiled in the background, the textures and buffers below load while it builds
+	ShaderCompiler shaderCompiler;
+	// The base shader comes in variants that are only built once something asks for them. The rectangle blends both
+	// textures, the moving rectangles and imported models use the single texture variant
+	ShaderVariants baseShaders(shaderCompiler, "SourceFiles/BaseVertexShader.vert", "SourceFiles/BaseFragmentShader.frag", { "BLEND_TEXTURE2" });
+	baseShaders.SetOnReady([](Shader& shaderObj)
 	{
-		std::cout << "Fail to load texture" << std::endl;
-	}
-	// Delete data
-	stbi_image_free(data);
-
-	unsigned int texture2;
-	glGenTextures(1, &texture2);
-	glBindTexture(GL_TEXTURE_2D, texture2);
-	// Set Wrapping setings for the S and T axis (texture coords are in STR instead of XYZ)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// Set Texture filtering for magnifying and minifying
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	stbi_set_flip_vertically_on_load(true);
-	unsigned char* data2 = stbi_load("Textures/KodyPic.png", &imgWidth, &imgHeight, &nrChannel, 0);
-	if (data2)
+		//Set Shader to use
+		shaderObj.UseShader();
+		shaderObj.BindUniformBlock(FrameBlock, UniformBindingFrame, sizeof(FrameUniforms));
+		shaderObj.BindUniformBlock(MaterialBlock, UniformBindingMaterial, sizeof(MaterialUniforms));
+		GLStateCache::Instance().Uniform1i(glGetUniformLocation(shaderObj.ID, "texture1"), 0); // manually
+		shaderObj.SetInt("texture2", 1); // with Shader class, these two lines do the same thing but shows how to send uniforms
+	});
+	baseShaders.Request(BaseVariantBlendTexture2);
+	// Sprite benchmark, only built when asked for. The sprite batch gets the program once it is ready (see below)
+	ShaderVariants spriteShaders(shaderCompiler, "SourceFiles/SpriteVertexShader.vert", "SourceFiles/SpriteFragmentShader.frag", {});
+	bool drawsSprites = spriteCount > 0;
+	if (drawsSprites)
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, imgWidth, imgHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, data2);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		spriteShaders.Request(0);
 	}
-	else
+	// The mesh batch reads the same instance attributes so it shares the shader
+	ShaderVariants instancedShaders(shaderCompiler, "SourceFiles/InstancedVertexShader.vert", "SourceFiles/InstancedFragmentShader.frag", {});
+	instancedShaders.SetOnReady([](Shader& shaderObj)
 	{
-		std::cout << "Fail to load texture" << std::endl;
+		shaderObj.UseShader();
+		shaderObj.BindUniformBlock(FrameBlock, UniformBindingFrame, sizeof(FrameUniforms));
+		shaderObj.SetInt("textureLayers", 0);
+		shaderObj.SetInt("texture2", 1);
+	});
+	bool drawsInstances = instanceCount > 0 || multiDrawCount > 0;
+	if (drawsInstances)
+	{
+		instancedShaders.Request(0);
 	}
-	// Delete data
-	stbi_image_free(data2);
+	// Saving a shader or anything it includes rebuilds the programs using it in the background, they swap in once linked
+	FileWatcher shaderWatcher;
+	shaderWatcher.WatchDirectory("SourceFiles");
+	std::vector<std::string> changedFiles;
+
+
+	// Generate Texture
+	// Decoding happens on worker threads, the handles show a placeholder until textureManager.Update() uploads them
+	TextureManager textureManager;
+	// Block compressed versions written by the bake_textures target, used when present
+	textureManager.SetBakedDirectory("Textures/Baked");
+	TextureHandle texture = textureManager.Load("Textures/WoodContainer.jpg");
+	TextureHandle texture2 = textureManager.Load("Textures/KodyPic.png", true);
+	// Instances pick their image by layer, so the instanced grid and the multidraw objects need no texture switches
+	TextureHandle instanceLayers = drawsInstances
+		? textureManager.LoadArray({ "Textures/WoodContainer.jpg", "Textures/WallTexture.jpg" }, true) : InvalidTextureHandle;
 
 
 	// ---- VBO & VAO ----
@@ -165,39 +313,298 @@ int main()
 	// We can send a VAO and it will send all the VBO and attribs valuies at the same time
 	// Definition ElementBufferObject (EBO) - are pieces of data or objects (buffers) that uses indices to determine which vertices to use. Prevents sending overlapping vertices
 	unsigned int VBO, VAO, EBO;
+	// _vertices is 8 floats a vertex, stored as half positions, byte colors and 16 bit uvs it is half the size.
+	// The shaders still read vec3/vec3/vec2
+	VertexLayout rectangleLayout;
+	rectangleLayout.Add(0, VertexType::Half, 3).Add(1, VertexType::UNorm8, 3).Add(2, VertexType::UNorm16, 2);
+	// Every mesh goes through the optimizer, then the compact layout and index type, before it reaches a buffer
+	std::vector<float> rectangleFloats(_vertices, _vertices + sizeof(_vertices) / sizeof(_vertices[0]));
+	std::vector<uint32_t> rectangleIndexList(_indices, _indices + sizeof(_indices) / sizeof(_indices[0]));
+	OptimizeMesh(rectangleFloats, 8, rectangleIndexList);
+	const size_t rectangleVertexCount = rectangleFloats.size() / 8;
+	std::vector<unsigned char> rectangleVertices = rectangleLayout.Encode(rectangleFloats.data(), rectangleVertexCount);
+	// Four vertices fit 16 bit indices, half the size of _indices
+	IndexBufferData rectangleIndices = BuildIndexBuffer(rectangleIndexList.data(), (unsigned int)rectangleIndexList.size(),
+		(unsigned int)rectangleVertexCount);
+	// Every bind goes through the state cache so it always knows what is bound
+	GLStateCache& stateCache = GLStateCache::Instance();
 	// 1. Generate VAO and VBO
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
 	glGenBuffers(1, &EBO);
 	// 2. Bind VAO
-	glBindVertexArray(VAO);
+	stateCache.BindVertexArray(VAO);
 	// 3. Bind Vertices to a VBO
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(_vertices), _vertices, GL_STATIC_DRAW);
+	stateCache.BindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)rectangleVertices.size(), rectangleVertices.data(), GL_STATIC_DRAW);
 	// 3a. Bind indices to an EBO
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(_indices), _indices, GL_STATIC_DRAW);
-	// 4. Set Verteices Attributes pointers
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// 4a. Set Color Attributes pointers
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*) (3* sizeof(float)));
-	glEnableVertexAttribArray(1);
-	// 4a. Set Texture Coordinate Attributes pointers
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*) (6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
+	stateCache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)rectangleIndices.Bytes.size(), rectangleIndices.Bytes.data(), GL_STATIC_DRAW);
+	// 4. Set Vertices, Color and Texture Coordinate Attributes pointers, the layout works out the offsets and types
+	rectangleLayout.Apply();
 	
 	// note that this is allowed, the call to glVertexAttribPointer registered VBO as the vertex attribute's bound vertex buffer object so afterwards we can safely unbind
 	// Unbind VBO as it is already bound
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	stateCache.BindBuffer(GL_ARRAY_BUFFER, 0);
 
 	// You can unbind the VAO afterwards so other VAO calls won't accidentally modify this VAO, but this rarely happens. Modifying other
 	// VAOs requires a call to glBindVertexArray anyways so we generally don't unbind VAOs (nor VBOs) when it's not directly necessary.
 	// Unbind VAO
-	glBindVertexArray(0);
+	stateCache.BindVertexArray(0);
 
 	// Unbind EBO - Always Unbind EBO AFTER unbinding VAO
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	stateCache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	// The same rectangle again, drawn as a grid of instances in a single draw call
+	InstancedMesh instancedRectangle;
+	if (instanceCount > 0)
+	{
+		instancedRectangle.Create(rectangleVertices.data(), rectangleVertices.size(), rectangleLayout.GetStride(),
+			rectangleLayout.GetAttributes(), rectangleLayout.GetElementCount(), rectangleIndexList.data(), (unsigned int)rectangleIndexList.size());
+
+		unsigned int columns = (unsigned int)std::ceil(std::sqrt((double)instanceCount));
+		unsigned int rows = (instanceCount + columns - 1) / columns;
+		float cellWidth = 2.0f / columns;
+		float cellHeight = 2.0f / rows;
+		std::vector<InstanceData> instances(instanceCount);
+		for (unsigned int i = 0; i < instanceCount; i++)
+		{
+			unsigned int column = i % columns;
+			unsigned int row = i / columns;
+			InstanceData& instance = instances[i];
+			// The rectangle is 1x1 around the origin, scale it a bit under the cell so the cells stay apart
+			instance.Model[0][0] = cellWidth * 0.9f;
+			instance.Model[1][1] = cellHeight * 0.9f;
+			instance.Model[3][0] = -1.0f + cellWidth * (column + 0.5f);
+			instance.Model[3][1] = -1.0f + cellHeight * (row + 0.5f);
+			instance.Tint = glm::vec4(0.6f + 0.4f * column / columns, 0.6f + 0.4f * row / rows, 1.0f, 1.0f);
+			instance.Layer = (float)((row + column) % 2);
+			instance.Blend = (float)column / columns;
+		}
+		instancedRectangle.SetInstances(instances.data(), instanceCount);
+	}
+
+	// Per frame data: the uniform blocks every frame, plus rectangles rewritten every frame with --dynamic. Their
+	// vertices and indices are bump allocated from the ring instead of re-uploaded, the vertex array points at the
+	// start of the ring and each frame's draw finds its data through base vertex and offset
+	DynamicRing dynamicRing;
+	unsigned int dynamicVAO = 0;
+	// Four vertices a rectangle and 16 bit indices
+	dynamicCount = std::min(dynamicCount, 65536u / 4);
+	// Each block may be padded out to the uniform offset alignment, which is at most 256
+	size_t uniformBytes = 2 * 256 + sizeof(FrameUniforms) + sizeof(MaterialUniforms);
+	size_t dynamicFrameBytes = dynamicCount * (4 * rectangleLayout.GetStride() + 6 * sizeof(uint16_t)) + 2 * rectangleLayout.GetStride();
+	if (dynamicRing.Create(uniformBytes + dynamicFrameBytes, persistentMap))
+	{
+		if (dynamicCount > 0)
+		{
+			glGenVertexArrays(1, &dynamicVAO);
+			stateCache.BindVertexArray(dynamicVAO);
+			stateCache.BindBuffer(GL_ARRAY_BUFFER, dynamicRing.GetBufferID());
+			stateCache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, dynamicRing.GetBufferID());
+			rectangleLayout.Apply();
+			stateCache.BindVertexArray(0);
+			stateCache.BindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+	}
+
+	// Polygons with 3 to 8 sides packed into one mesh batch, each object picks a shape, a spot and one of two materials
+	MeshBatch meshBatch;
+	std::vector<BatchMesh> polygons;
+	std::vector<InstanceData> polygonInstances;
+	if (multiDrawCount > 0)
+	{
+		meshBatch.Create(rectangleLayout.GetStride(), rectangleLayout.GetAttributes(), rectangleLayout.GetElementCount());
+		if (!multiDrawIndirect)
+		{
+			meshBatch.SetMultiDrawIndirect(false);
+		}
+		for (unsigned int sides = 3; sides <= 8; sides++)
+		{
+			// A fan around the center vertex, radius 0.5 to match the rectangle
+			std::vector<float> vertices = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.5f, 0.5f };
+			std::vector<uint32_t> indices;
+			for (unsigned int corner = 0; corner < sides; corner++)
+			{
+				float angle = 6.2831853f * corner / sides;
+				float x = 0.5f * std::cos(angle);
+				float y = 0.5f * std::sin(angle);
+				vertices.insert(vertices.end(), { x, y, 0.0f, 1.0f, 1.0f, 1.0f, x + 0.5f, y + 0.5f });
+				indices.insert(indices.end(), { 0, corner + 1, (corner + 1) % sides + 1 });
+			}
+			OptimizeMesh(vertices, 8, indices);
+			unsigned int vertexCount = (unsigned int)(vertices.size() / 8);
+			std::vector<unsigned char> encoded = rectangleLayout.Encode(vertices.data(), vertexCount);
+			polygons.push_back(meshBatch.AddMesh(encoded.data(), vertexCount, indices.data(), (unsigned int)indices.size()));
+		}
+		meshBatch.Upload();
+
+		unsigned int columns = (unsigned int)std::ceil(std::sqrt((double)multiDrawCount));
+		unsigned int rows = (multiDrawCount + columns - 1) / columns;
+		float cellWidth = 2.0f / columns;
+		float cellHeight = 2.0f / rows;
+		polygonInstances.resize(multiDrawCount);
+		for (unsigned int i = 0; i < multiDrawCount; i++)
+		{
+			unsigned int column = i % columns;
+			unsigned int row = i / columns;
+			InstanceData& instance = polygonInstances[i];
+			instance.Model[0][0] = cellWidth * 0.9f;
+			instance.Model[1][1] = cellHeight * 0.9f;
+			instance.Model[3][0] = -1.0f + cellWidth * (column + 0.5f);
+			instance.Model[3][1] = -1.0f + cellHeight * (row + 0.5f);
+			instance.Tint = glm::vec4(1.0f, 0.6f + 0.4f * row / rows, 0.6f + 0.4f * column / columns, 1.0f);
+			instance.Layer = (float)(i % 2);
+			instance.Blend = 0.25f;
+		}
+	}
+
+	// A grid with its triangles shuffled with a fixed seed, about the worst order a real mesh could arrive in
+	if (optimizeGridSize > 1)
+	{
+		std::vector<float> gridVertices;
+		std::vector<uint32_t> gridIndices;
+		for (unsigned int y = 0; y < optimizeGridSize; y++)
+		{
+			for (unsigned int x = 0; x < optimizeGridSize; x++)
+			{
+				float u = (float)x / (optimizeGridSize - 1);
+				float v = (float)y / (optimizeGridSize - 1);
+				gridVertices.insert(gridVertices.end(), { u - 0.5f, v - 0.5f, 0.0f, 1.0f, 1.0f, 1.0f, u, v });
+			}
+		}
+		for (unsigned int y = 0; y + 1 < optimizeGridSize; y++)
+		{
+			for (unsigned int x = 0; x + 1 < optimizeGridSize; x++)
+			{
+				uint32_t corner = y * optimizeGridSize + x;
+				gridIndices.insert(gridIndices.end(), { corner, corner + 1, corner + optimizeGridSize,
+					corner + 1, corner + optimizeGridSize + 1, corner + optimizeGridSize });
+			}
+		}
+		unsigned int seed = 12345;
+		size_t triangleCount = gridIndices.size() / 3;
+		for (size_t i = triangleCount - 1; i > 0; i--)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			size_t j = seed % (i + 1);
+			std::swap_ranges(gridIndices.begin() + i * 3, gridIndices.begin() + i * 3 + 3, gridIndices.begin() + j * 3);
+		}
+
+		auto optimizeStart = std::chrono::steady_clock::now();
+		MeshOptimizeReport report = OptimizeMesh(gridVertices, 8, gridIndices);
+		double optimizeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - optimizeStart).count();
+		std::cout << "Mesh optimizer: " << optimizeGridSize << "x" << optimizeGridSize << " grid, " << triangleCount << " triangles"
+			<< " | ACMR " << report.Before.Acmr << " -> " << report.After.Acmr
+			<< " | ATVR " << report.Before.Atvr << " -> " << report.After.Atvr
+			<< " | " << optimizeMs << " ms" << std::endl;
+	}
+
+	// Imported model, glTF straight from the file into its buffer, OBJ parsed on the pool then optimized and compacted
+	Model importedModel;
+	if (!importPath.empty())
+	{
+		bool loaded = false;
+		if (importPath.size() > 4 && importPath.compare(importPath.size() - 4, 4, ".glb") == 0)
+		{
+			loaded = importedModel.LoadGLB(importPath);
+		}
+		else
+		{
+			ThreadPool importPool;
+			ImportedMesh mesh;
+			loaded = ImportOBJ(importPath, mesh, &importPool);
+			if (loaded)
+			{
+				importedModel.Create(std::move(mesh));
+			}
+		}
+		if (loaded)
+		{
+			std::cout << "Imported " << importPath << ": " << importedModel.GetPrimitives().size() << " primitives, "
+				<< importedModel.GetBufferBytes() / 1024 << " KB" << std::endl;
+		}
+	}
+
+	// The single texture variant is only built when something draws with it
+	bool drawsSingleTexture = dynamicVAO != 0 || !importedModel.GetPrimitives().empty();
+	if (drawsSingleTexture)
+	{
+		baseShaders.Request(0);
+	}
+
+	// OBJ parse throughput on a generated grid, the text is built in memory so disk speed stays out of it
+	if (objBenchmarkSize > 1)
+	{
+		std::string objText;
+		char line[128];
+		for (unsigned int y = 0; y < objBenchmarkSize; y++)
+		{
+			for (unsigned int x = 0; x < objBenchmarkSize; x++)
+			{
+				float u = (float)x / (objBenchmarkSize - 1);
+				float v = (float)y / (objBenchmarkSize - 1);
+				objText.append(line, snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn 0 0 1\n",
+					u - 0.5f, v - 0.5f, 0.25f * std::sin(u * 12.0f) * std::cos(v * 12.0f), u, v));
+			}
+		}
+		for (unsigned int y = 0; y + 1 < objBenchmarkSize; y++)
+		{
+			for (unsigned int x = 0; x + 1 < objBenchmarkSize; x++)
+			{
+				// OBJ indices start at 1
+				unsigned int corner = y * objBenchmarkSize + x + 1;
+				unsigned int right = corner + 1;
+				unsigned int up = corner + objBenchmarkSize;
+				objText.append(line, snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n",
+					corner, corner, corner, right, right, right, up + 1, up + 1, up + 1, up, up, up));
+			}
+		}
+
+		double megabytes = objText.size() / (1024.0 * 1024.0);
+		ImportedMesh serialMesh;
+		auto serialStart = std::chrono::steady_clock::now();
+		ParseOBJ(objText.data(), objText.size(), serialMesh);
+		double serialMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - serialStart).count();
+		ThreadPool benchmarkPool;
+		ImportedMesh parallelMesh;
+		auto parallelStart = std::chrono::steady_clock::now();
+		ParseOBJ(objText.data(), objText.size(), parallelMesh, &benchmarkPool);
+		double parallelMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - parallelStart).count();
+		std::cout << "OBJ import: " << megabytes << " MB, " << parallelMesh.VertexCount() << " vertices, "
+			<< parallelMesh.Indices.size() / 3 << " triangles"
+			<< " | 1 thread " << megabytes * 1000.0 / serialMs << " MB/s"
+			<< " | " << benchmarkPool.ThreadCount() << " threads " << megabytes * 1000.0 / parallelMs << " MB/s"
+			<< (serialMesh.Indices == parallelMesh.Indices && serialMesh.Vertices == parallelMesh.Vertices ? "" : " | MISMATCH")
+			<< std::endl;
+	}
+
+	// Benchmark sprites, scattered over the screen with a fixed seed so every run draws the same thing
+	SpriteBatch spriteBatch;
+	// Runs again after a reload, so the batch always draws with the current program
+	spriteShaders.SetOnReady([&spriteBatch](Shader& shaderObj)
+	{
+		spriteBatch.SetProgram(shaderObj.ID);
+	});
+	std::vector<SpriteRect> spriteRects;
+	if (spriteCount > 0)
+	{
+		spriteBatch.Create();
+		spriteRects.resize(spriteCount);
+		unsigned int seed = 12345;
+		auto random = [&seed]()
+		{
+			seed = seed * 1664525u + 1013904223u;
+			return (float)(seed >> 8) / 16777216.0f;
+		};
+		for (SpriteRect& rect : spriteRects)
+		{
+			rect.Width = 2.0f + random() * 6.0f;
+			rect.Height = rect.Width;
+			rect.X = random() * (ScreenWidth - rect.Width);
+			rect.Y = random() * (ScreenHeight - rect.Height);
+		}
+	}
 
 
 #pragma region Exercise Draw Triangles
@@ -239,19 +646,158 @@ int main()
 #pragma endregion Exercise Draw Triangles
 
 
-	//Set Shader to use
-	shaderObj.UseShader();
-	glUniform1i(glGetUniformLocation(shaderObj.ID, "texture1"), 0); // manually
-	shaderObj.SetInt("texture2", 1); // with Shader class, these two lines do the same thing but shows how to send uniforms
+	// Headless frame timing, each frame is waited on with glFinish so the CPU time covers the GPU work too
+	unsigned int frameCount = 0;
+	double totalFrameMs = 0.0;
+	double minFrameMs = 1e9;
+	double maxFrameMs = 0.0;
+	// GPU pass times come back a few frames late, these add up whatever has arrived
+	unsigned long long gpuFrames = 0;
+	double totalGpuMs = 0.0;
+	unsigned long long totalDrawCalls = 0;
+	unsigned long long totalUploadBytes = 0;
+	// State calls the cache let through and the redundant ones it dropped
+	unsigned long long totalIssuedCalls = 0;
+	unsigned long long totalFilteredCalls = 0;
+	// Time spent in the sprite batch, and the part of it that is queueing sprites and writing vertices
+	double totalSpriteMs = 0.0;
+	double totalSpriteBuildMs = 0.0;
+	unsigned long long spriteFrames = 0;
+	unsigned long long spriteDrawCalls = 0;
+	unsigned long long multiDrawFrames = 0;
+	unsigned long long multiDrawCalls = 0;
+	double totalMultiDrawMs = 0.0;
+	unsigned long long dynamicFrames = 0;
+	unsigned long long dynamicBytes = 0;
+	double totalDynamicMs = 0.0;
+	// Scene recording split over --record-jobs jobs, and replaying what they recorded
+	unsigned long long recordFrames = 0;
+	unsigned long long totalRecordItems = 0;
+	unsigned long long totalRecordBytes = 0;
+	double totalRecordMs = 0.0;
+	double totalReplayMs = 0.0;
+
+	Profiler& profiler = Profiler::Instance();
+	RenderQueue renderQueue;
+	// Job 0 runs on this thread, the others on recordJobs - 1 workers
+	CommandRecorder sceneRecorder(recordJobs - 1);
+	unsigned long long resolvedFrames = 0;
+
+	// For the frame block's time values
+	auto runStart = std::chrono::steady_clock::now();
+	auto lastFrameStart = runStart;
 
 	// Run while the window is open (main loop)
-	while (!glfwWindowShouldClose(window))
+	bool running = true;
+	while (running)
 	{
+		auto frameStart = std::chrono::steady_clock::now();
+		profiler.BeginFrame();
+
+#ifndef WIG_NO_GLFW
 		// Check and call inputs
-		processInput(window);
+		if (!headless)
+		{
+			processInput(window);
+		}
+#endif // !WIG_NO_GLFW
 
-		// Clear Screen
-		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+		{
+			ProfileZone streamingZone("Streaming");
+			// Pick up the shader once the compiler has finished it, frames keep presenting until then
+			shaderCompiler.Poll();
+			shaderWatcher.Poll(changedFiles);
+			if (!changedFiles.empty())
+			{
+				baseShaders.Reload(changedFiles);
+				spriteShaders.Reload(changedFiles);
+				instancedShaders.Reload(changedFiles);
+			}
+			// Upload any textures the decode workers have finished
+			textureManager.Update();
+		}
+		// Null until each variant has compiled
+		const Shader* blendShader = baseShaders.Request(BaseVariantBlendTexture2);
+		const Shader* singleTextureShader = drawsSingleTexture ? baseShaders.Request(0) : nullptr;
+		const Shader* spriteShader = drawsSprites ? spriteShaders.Request(0) : nullptr;
+		const Shader* instancedShader = drawsInstances ? instancedShaders.Request(0) : nullptr;
+
+		// Frame and material blocks, one write each into the ring. Frame is bound once here for every program,
+		// the material range travels with the packets that use it
+		dynamicRing.BeginFrame();
+		FrameUniforms frameUniforms;
+		frameUniforms.Resolution = glm::vec2((float)ScreenWidth, (float)ScreenHeight);
+		frameUniforms.Time = std::chrono::duration<float>(frameStart - runStart).count();
+		frameUniforms.DeltaTime = std::chrono::duration<float>(frameStart - lastFrameStart).count();
+		lastFrameStart = frameStart;
+		MaterialUniforms materialUniforms;
+		materialUniforms.ArrowAlpha = arrowAlpha;
+		DynamicAllocation frameBlock;
+		DynamicAllocation materialBlock;
+		PacketUniformBlock material;
+		if (dynamicRing.AllocateUniforms(sizeof(FrameUniforms), frameBlock) &&
+			dynamicRing.AllocateUniforms(sizeof(MaterialUniforms), materialBlock))
+		{
+			memcpy(frameBlock.Memory, &frameUniforms, sizeof(FrameUniforms));
+			memcpy(materialBlock.Memory, &materialUniforms, sizeof(MaterialUniforms));
+			stateCache.BindBufferRange(GL_UNIFORM_BUFFER, UniformBindingFrame, dynamicRing.GetBufferID(), frameBlock.Offset, sizeof(FrameUniforms));
+			material.Binding = UniformBindingMaterial;
+			material.Buffer = dynamicRing.GetBufferID();
+			material.Offset = materialBlock.Offset;
+			material.Size = sizeof(MaterialUniforms);
+		}
+
+		// This frame's rectangles, written straight into the ring's mapping
+		DrawPacket dynamicRectangles;
+		dynamicRectangles.VertexArray = dynamicVAO;
+		dynamicRectangles.IndexType = GL_UNSIGNED_SHORT;
+		if (dynamicVAO != 0)
+		{
+			auto dynamicStart = std::chrono::steady_clock::now();
+			const size_t stride = rectangleLayout.GetStride();
+			DynamicAllocation vertices;
+			DynamicAllocation indices;
+			if (dynamicRing.Allocate(dynamicCount * 4 * stride, stride, vertices) &&
+				dynamicRing.Allocate(dynamicCount * 6 * sizeof(uint16_t), 0, indices))
+			{
+				unsigned int columns = (unsigned int)std::ceil(std::sqrt((double)dynamicCount));
+				unsigned int rows = (dynamicCount + columns - 1) / columns;
+				float cellWidth = 2.0f / columns;
+				float cellHeight = 2.0f / rows;
+				float time = dynamicFrames * 0.05f;
+				uint16_t* index = (uint16_t*)indices.Memory;
+				for (unsigned int i = 0; i < dynamicCount; i++)
+				{
+					float centerX = -1.0f + cellWidth * (i % columns + 0.5f + 0.25f * std::sin(time + i));
+					float centerY = -1.0f + cellHeight * (i / columns + 0.5f + 0.25f * std::cos(time + i));
+					for (unsigned int corner = 0; corner < 4; corner++)
+					{
+						const float* source = _vertices + corner * 8;
+						float position[3] = { centerX + source[0] * cellWidth * 0.5f, centerY + source[1] * cellHeight * 0.5f, 0.0f };
+						unsigned char* vertex = vertices.Memory + (i * 4 + corner) * stride;
+						rectangleLayout.Write(vertex, 0, position);
+						rectangleLayout.Write(vertex, 1, source + 3);
+						rectangleLayout.Write(vertex, 2, source + 6);
+					}
+					for (unsigned int j = 0; j < 6; j++)
+					{
+						*index++ = (uint16_t)(i * 4 + _indices[j]);
+					}
+				}
+				dynamicRectangles.BaseVertex = (int)(vertices.Offset / stride);
+				dynamicRectangles.IndexOffset = indices.Offset;
+				dynamicRectangles.IndexCount = dynamicCount * 6;
+			}
+			totalDynamicMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - dynamicStart).count();
+		}
+
+		// Before any draw reads it
+		dynamicRing.Flush();
+
+		profiler.BeginGpuPass("Scene");
+
+		// Clear Screen, the color never changes so after the first frame the cache drops this
+		stateCache.ClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
 		//Rendering commands
@@ -267,18 +813,168 @@ int main()
 		//}
 		// Send values to uniform at given location
 		//glUniform4f(vertexColorLocation, 0.0f, greenValue, 0.0f, 1.0f);
-		shaderObj.SetFloat("arrowAlpha", arrowAlpha);
+		bool drawsBatch = multiDrawCount > 0 && instancedShader != nullptr;
+		double multiDrawMs = 0.0;
+		if (drawsBatch)
+		{
+			auto multiDrawStart = std::chrono::steady_clock::now();
+			// Same shader and layers both times, the second material blends towards the wood texture instead of the
+			// picture. Refreshed every frame since the textures are placeholders until they finish streaming, and
+			// before recording since the recorded draws only carry the material id
+			BatchMaterial wood;
+			wood.Program = instancedShader->ID;
+			wood.Textures[0] = textureManager.GetTextureID(instanceLayers);
+			wood.TextureTargets[0] = textureManager.GetTextureTarget(instanceLayers);
+			wood.Textures[1] = textureManager.GetTextureID(texture2);
+			wood.TextureCount = 2;
+			BatchMaterial kody = wood;
+			kody.Textures[1] = textureManager.GetTextureID(texture);
+			if (meshBatch.GetMaterialCount() == 0)
+			{
+				meshBatch.AddMaterial(wood);
+				meshBatch.AddMaterial(kody);
+			}
+			meshBatch.SetMaterial(0, wood);
+			meshBatch.SetMaterial(1, kody);
+			multiDrawMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - multiDrawStart).count();
+		}
 
-		// Bind Texture
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture2);
-		// Bind VAO that we want to use
-		glBindVertexArray(VAO);
+		// The scene as a flat list of items in a fixed order: the rectangle, each index range of the instanced grid,
+		// the dynamic rectangles, each imported primitive and each mesh batch object. Every job records a contiguous
+		// slice and the slices are replayed in job order, so the packets and batch draws come out the same whatever
+		// the job count
+		unsigned int rectangleItems = blendShader ? 1 : 0;
+		unsigned int gridItems = instancedShader != nullptr && instancedRectangle.GetInstanceCount() > 0 ?
+			(unsigned int)instancedRectangle.GetIndexRanges().size() : 0;
+		unsigned int dynamicItems = singleTextureShader && dynamicRectangles.IndexCount > 0 ? 1 : 0;
+		unsigned int importedItems = singleTextureShader ? (unsigned int)importedModel.GetPrimitives().size() : 0;
+		unsigned int batchItems = drawsBatch ? multiDrawCount : 0;
+		unsigned int sceneItems = rectangleItems + gridItems + dynamicItems + importedItems + batchItems;
+		if (sceneItems > 0)
+		{
+			// Texture ids are looked up here on the GL thread, the jobs only copy this
+			DrawPacket base;
+			base.VertexArray = VAO;
+			base.Textures[0] = textureManager.GetTextureID(texture);
+			base.Textures[1] = textureManager.GetTextureID(texture2);
+			base.TextureCount = 2;
+			base.UniformBlocks[0] = material;
+			base.UniformBlockCount = 1;
+			unsigned int layersID = textureManager.GetTextureID(instanceLayers);
+			unsigned int layersTarget = textureManager.GetTextureTarget(instanceLayers);
 
-		// Draw Rectangle
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+			unsigned int jobCount = std::min(recordJobs, sceneItems);
+			auto recordStart = std::chrono::steady_clock::now();
+			sceneRecorder.Record(jobCount, [&](CommandBuffer& commands, unsigned int job)
+			{
+				unsigned int first = (unsigned int)((unsigned long long)sceneItems * job / jobCount);
+				unsigned int end = (unsigned int)((unsigned long long)sceneItems * (job + 1) / jobCount);
+				for (unsigned int item = first; item < end; item++)
+				{
+					unsigned int index = item;
+					if (index < rectangleItems)
+					{
+						// Everything the rectangle needs goes in one packet, the queue binds it when replaying
+						DrawPacket rectangle = base;
+						rectangle.Program = blendShader->ID;
+						rectangle.IndexType = rectangleIndices.Type;
+						rectangle.IndexCount = rectangleIndices.Ranges[0].Count;
+						commands.Submit(RenderQueue::MakeSortKey(0, false, blendShader->ID, texture, 0.5f), rectangle);
+						continue;
+					}
+					index -= rectangleItems;
+					if (index < gridItems)
+					{
+						// Every instance of the range in one packet, drawn in front of the rectangle
+						const IndexRange& range = instancedRectangle.GetIndexRanges()[index];
+						DrawPacket grid = base;
+						grid.Program = instancedShader->ID;
+						grid.VertexArray = instancedRectangle.GetVertexArray();
+						grid.Textures[0] = layersID;
+						grid.TextureTargets[0] = layersTarget;
+						grid.IndexType = instancedRectangle.GetIndexType();
+						grid.InstanceCount = instancedRectangle.GetInstanceCount();
+						grid.IndexCount = range.Count;
+						grid.IndexOffset = range.Offset;
+						grid.BaseVertex = range.BaseVertex;
+						commands.Submit(RenderQueue::MakeSortKey(1, false, instancedShader->ID, instanceLayers, 0.5f), grid);
+						continue;
+					}
+					index -= gridItems;
+					if (index < dynamicItems)
+					{
+						DrawPacket moving = base;
+						moving.Program = singleTextureShader->ID;
+						moving.VertexArray = dynamicRectangles.VertexArray;
+						moving.IndexType = dynamicRectangles.IndexType;
+						moving.IndexCount = dynamicRectangles.IndexCount;
+						moving.IndexOffset = dynamicRectangles.IndexOffset;
+						moving.BaseVertex = dynamicRectangles.BaseVertex;
+						commands.Submit(RenderQueue::MakeSortKey(1, false, singleTextureShader->ID, texture, 0.5f), moving);
+						continue;
+					}
+					index -= dynamicItems;
+					if (index < importedItems)
+					{
+						// The imported model on top, with the rectangle's textures
+						const ModelPrimitive& primitive = importedModel.GetPrimitives()[index];
+						DrawPacket imported = base;
+						imported.Program = singleTextureShader->ID;
+						imported.VertexArray = primitive.VertexArray;
+						imported.Mode = primitive.Mode;
+						imported.IndexType = primitive.IndexType;
+						imported.IndexCount = primitive.IndexCount;
+						imported.IndexOffset = primitive.IndexOffset;
+						imported.BaseVertex = primitive.BaseVertex;
+						commands.Submit(RenderQueue::MakeSortKey(2, false, singleTextureShader->ID, texture, 0.5f), imported);
+						continue;
+					}
+					index -= importedItems;
+					// Shapes cycle every object, materials every other row of seven so both materials mix every shape
+					commands.DrawBatched(meshBatch, polygons[index % polygons.size()], (index / 7) % 2, polygonInstances[index]);
+				}
+			});
+			auto recordEnd = std::chrono::steady_clock::now();
+			sceneRecorder.Execute(renderQueue);
+			totalRecordMs += std::chrono::duration<double, std::milli>(recordEnd - recordStart).count();
+			totalReplayMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordEnd).count();
+			totalRecordItems += sceneItems;
+			totalRecordBytes += sceneRecorder.BytesRecorded();
+			recordFrames++;
+		}
+		// Sort and draw
+		renderQueue.Flush();
+
+		if (drawsBatch)
+		{
+			// The batch draws were queued while replaying
+			auto multiDrawStart = std::chrono::steady_clock::now();
+			meshBatch.Flush();
+			multiDrawMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - multiDrawStart).count();
+			totalMultiDrawMs += multiDrawMs;
+			multiDrawFrames++;
+			multiDrawCalls += meshBatch.LastDrawCalls();
+		}
+
+		if (spriteCount > 0 && spriteShader != nullptr)
+		{
+			auto spriteStart = std::chrono::steady_clock::now();
+			spriteBatch.Begin((float)ScreenWidth, (float)ScreenHeight);
+			unsigned int woodID = textureManager.GetTextureID(texture);
+			unsigned int kodyID = textureManager.GetTextureID(texture2);
+			for (unsigned int i = 0; i < spriteCount; i++)
+			{
+				// Texture changes every 1024 sprites so the batch has a few runs to flush
+				spriteBatch.Draw((i / 1024) % 2 == 0 ? woodID : kodyID, spriteRects[i], SpriteRect(),
+					PackSpriteColor(1.0f, 0.5f, 0.2f, 0.9f), (float)(i % 4) * 0.25f);
+			}
+			double queueMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - spriteStart).count();
+			spriteBatch.End();
+			totalSpriteMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - spriteStart).count();
+			totalSpriteBuildMs += queueMs + spriteBatch.LastWriteMs();
+			spriteFrames++;
+			spriteDrawCalls += spriteBatch.LastDrawCalls();
+		}
 
 #pragma region Draw triangle Exercise
 		////Draw Triangles for exercise
@@ -291,24 +987,131 @@ int main()
 		//// Draw Rectangle
 		//glDrawArrays(GL_TRIANGLES, 0, 3);
 #pragma endregion
+		profiler.EndGpuPass();
+
+		dynamicRing.EndFrame();
+		if (dynamicVAO != 0)
+		{
+			dynamicFrames++;
+			dynamicBytes += dynamicRing.LastFrameBytes();
+		}
+
+		if (headless)
+		{
+			glFinish();
+			double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+			totalFrameMs += frameMs;
+			minFrameMs = std::min(minFrameMs, frameMs);
+			maxFrameMs = std::max(maxFrameMs, frameMs);
+			running = ++frameCount < headlessFrames;
+		}
+#ifndef WIG_NO_GLFW
+		else
+		{
+			// Swap buffers
+			glfwSwapBuffers(window);
+			// Checks and call events
+			glfwPollEvents();
+			running = !glfwWindowShouldClose(window);
+		}
+#endif // !WIG_NO_GLFW
 
-		// Swap buffers
-		glfwSwapBuffers(window);
-		// Checks and call events
-		glfwPollEvents();
+		profiler.EndFrame();
+		stateCache.EndFrame();
+		totalFilteredCalls += stateCache.LastFrameFiltered();
+		totalIssuedCalls += stateCache.LastFrameIssued();
+		const ProfilerFrameStats& stats = profiler.LastFrame();
+		if (profiler.ResolvedFrames() != resolvedFrames)
+		{
+			resolvedFrames = profiler.ResolvedFrames();
+			totalDrawCalls += stats.DrawCalls;
+			totalUploadBytes += stats.UploadBytes;
+			if (stats.GpuMs >= 0.0)
+			{
+				gpuFrames++;
+				totalGpuMs += stats.GpuMs;
+			}
+		}
+	}
+
+	if (headless)
+	{
+		std::cout << "Headless frames: " << frameCount
+			<< " | avg " << totalFrameMs / frameCount << " ms"
+			<< " | min " << minFrameMs << " ms"
+			<< " | max " << maxFrameMs << " ms" << std::endl;
+		std::cout << "GPU: avg " << (gpuFrames > 0 ? totalGpuMs / gpuFrames : 0.0) << " ms over " << gpuFrames << " frames"
+			<< " | draw calls " << totalDrawCalls
+			<< " | uploaded " << totalUploadBytes / 1024 << " KB" << std::endl;
+		std::cout << "Vertex layout: " << rectangleLayout.GetStride() << " bytes per vertex, "
+			<< rectangleLayout.GetSourceFloats() * sizeof(float) << " as floats" << std::endl;
+		std::cout << "State calls per frame: issued " << (double)totalIssuedCalls / frameCount
+			<< " | filtered " << (double)totalFilteredCalls / frameCount << std::endl;
+		if (spriteFrames > 0)
+		{
+			std::cout << "Sprites: " << spriteCount << " per frame over " << spriteFrames << " frames"
+				<< " | " << (double)spriteDrawCalls / spriteFrames << " draw calls"
+				<< " | batch avg " << totalSpriteMs / spriteFrames << " ms"
+				<< " | " << (double)spriteCount * spriteFrames / totalSpriteMs << " sprites/ms"
+				<< " | build only " << (double)spriteCount * spriteFrames / totalSpriteBuildMs << " sprites/ms" << std::endl;
+		}
+		if (multiDrawFrames > 0)
+		{
+			std::cout << "Mesh batch: " << multiDrawCount << " objects per frame over " << multiDrawFrames << " frames"
+				<< " | " << (meshBatch.UsesMultiDrawIndirect() ? "multi draw indirect" : "draw loop")
+				<< " | " << (double)multiDrawCalls / multiDrawFrames << " draw calls"
+				<< " | avg " << totalMultiDrawMs / multiDrawFrames << " ms" << std::endl;
+		}
+		if (recordFrames > 0)
+		{
+			std::cout << "Scene recording: " << recordJobs << " jobs on " << sceneRecorder.WorkerCount() << " workers"
+				<< " | " << (double)totalRecordItems / recordFrames << " items per frame"
+				<< " | " << totalRecordBytes / recordFrames / 1024 << " KB a frame"
+				<< " | record avg " << totalRecordMs / recordFrames << " ms"
+				<< " | replay avg " << totalReplayMs / recordFrames << " ms" << std::endl;
+		}
+		if (dynamicFrames > 0)
+		{
+			std::cout << "Dynamic ring: " << dynamicCount << " rectangles per frame over " << dynamicFrames << " frames"
+				<< " | " << (dynamicRing.IsPersistent() ? "persistent map" : "unsynchronized map")
+				<< " | " << dynamicBytes / dynamicFrames / 1024 << " KB a frame"
+				<< " | write avg " << totalDynamicMs / dynamicFrames << " ms"
+				<< " | stalls " << dynamicRing.StallCount() << std::endl;
+		}
+	}
+	if (!tracePath.empty() && profiler.WriteChromeTrace(tracePath))
+	{
+		std::cout << "Trace written to " << tracePath << std::endl;
 	}
 
 	// Cleanup if window closes
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
+	stateCache.DeleteVertexArray(VAO);
+	stateCache.DeleteBuffer(VBO);
+	stateCache.DeleteBuffer(EBO);
+	spriteBatch.Release();
+	instancedRectangle.Release();
+	meshBatch.Release();
+	importedModel.Release();
+	stateCache.DeleteVertexArray(dynamicVAO);
+	dynamicRing.Destroy();
+	textureManager.Release();
+	profiler.Release();
 
-	glfwTerminate();
+#ifdef WIG_HEADLESS
+	headlessContext.Destroy();
+#endif // WIG_HEADLESS
+#ifndef WIG_NO_GLFW
+	if (!headless)
+	{
+		glfwTerminate();
+	}
+#endif // !WIG_NO_GLFW
 	return 0;
 }
 
 
 #pragma region Private Methods
+#ifndef WIG_NO_GLFW
 
 /// <summary>
 /// Callback for when the window is resized
@@ -318,7 +1121,7 @@ int main()
 /// <param name="height"> height of the new window size </param>
 void FrameBufferSizeCallback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	GLStateCache::Instance().Viewport(0, 0, width, height);
 }
 
 /// <summary>
@@ -333,11 +1136,12 @@ void processInput(GLFWwindow* window)
 	}
 	else if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS)
 	{
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		// Held keys call this every frame, the cache only lets the first one through
+		GLStateCache::Instance().PolygonMode(GL_FILL);
 	}
 	else if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
 	{
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		GLStateCache::Instance().PolygonMode(GL_LINE);
 	}
 	else if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
 	{
@@ -350,4 +1154,5 @@ void processInput(GLFWwindow* window)
 		arrowAlpha = (arrowAlpha < 0.0f) ? 0.0f : arrowAlpha;
 	}
 }
+#endif // !WIG_NO_GLFW
 #pragma endregion Private Methods
@@ -0,0 +1,191 @@
+/// ---- Summary ----
+/// Author: Kody Wood
+/// Description: wig-texbake, offline texture baker. Turns every image in a folder into KTX2 files with a
+/// block compressed mip chain so the engine can skip decoding and glGenerateMipmap at load time.
+/// Each image is baked twice, <name>.ktx2 as stored and <name>.flip.ktx2 bottom to top for flipped loads.
+/// Usage: wig-texbake <inputDir> <outputDir> [--format auto|bc1|bc3|bc7] [--srgb]
+/// -----------------
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "../SourceFiles/BlockCompression.h"
+#include "../SourceFiles/KTX2.h"
+#include "../SourceFiles/stb_image.h"
+
+namespace fs = std::filesystem;
+
+enum class FormatChoice
+{
+	Auto,	// BC1 for opaque images, BC7 when there is any alpha
+	BC1,
+	BC3,
+	BC7
+};
+
+static void PrintUsage()
+{
+	std::cout << "Usage: wig-texbake <inputDir> <outputDir> [--format auto|bc1|bc3|bc7] [--srgb]" << std::endl;
+}
+
+static bool IsImageFile(const fs::path& path)
+{
+	std::string extension = path.extension().string();
+	for (char& c : extension)
+	{
+		c = (char)tolower((unsigned char)c);
+	}
+	return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp";
+}
+
+static const char* FormatName(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return "BC1";
+	case BlockFormat::BC3: return "BC3";
+	case BlockFormat::BC7: return "BC7";
+	}
+	return "?";
+}
+
+/// <summary>
+/// Bakes one image
+/// </summary>
+/// <returns> false if the image could not be read or the output could not be written </returns>
+/// <param name="flip"> rows bottom to top like the engine's flipped loads, so (0,0) is the bottom left in GL </param>
+static bool BakeFile(const fs::path& input, const fs::path& output, FormatChoice choice, bool srgb, bool flip)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	RGBAImage image;
+	int channels = 0;
+	stbi_set_flip_vertically_on_load(flip);
+	unsigned char* pixels = stbi_load(input.string().c_str(), &image.Width, &image.Height, &channels, 4);
+	if (!pixels)
+	{
+		std::cout << "ERROR::TEXBAKE::READ_FAILED " << input.string() << ": " << stbi_failure_reason() << std::endl;
+		return false;
+	}
+	image.Pixels.assign(pixels, pixels + (size_t)image.Width * image.Height * 4);
+	stbi_image_free(pixels);
+
+	BlockFormat format = BlockFormat::BC1;
+	switch (choice)
+	{
+	case FormatChoice::Auto:
+	{
+		bool hasAlpha = false;
+		for (size_t i = 3; i < image.Pixels.size() && !hasAlpha; i += 4)
+		{
+			hasAlpha = image.Pixels[i] != 255;
+		}
+		format = hasAlpha ? BlockFormat::BC7 : BlockFormat::BC1;
+		break;
+	}
+	case FormatChoice::BC1: format = BlockFormat::BC1; break;
+	case FormatChoice::BC3: format = BlockFormat::BC3; break;
+	case FormatChoice::BC7: format = BlockFormat::BC7; break;
+	}
+
+	std::vector<RGBAImage> mips = BuildMipChain(image, srgb);
+	std::vector<std::vector<unsigned char>> levels;
+	size_t compressedBytes = 0;
+	size_t uncompressedBytes = 0;
+	for (const RGBAImage& mip : mips)
+	{
+		levels.push_back(CompressImage(mip, format));
+		compressedBytes += levels.back().size();
+		// What the runtime path used to keep in VRAM for the same image
+		uncompressedBytes += (size_t)mip.Width * mip.Height * (channels == 4 ? 4 : 3);
+	}
+
+	if (!WriteKTX2(output.string(), format, srgb, flip, image.Width, image.Height, levels))
+	{
+		std::cout << "ERROR::TEXBAKE::WRITE_FAILED " << output.string() << std::endl;
+		return false;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << input.filename().string() << " -> " << output.filename().string() << "  " << image.Width << "x" << image.Height
+		<< " " << FormatName(format) << (srgb ? " sRGB" : "") << ", " << levels.size() << " mips, "
+		<< uncompressedBytes / 1024 << " KB -> " << compressedBytes / 1024 << " KB ("
+		<< (double)uncompressedBytes / (double)compressedBytes << "x) in " << ms << " ms" << std::endl;
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	fs::path inputDir = argv[1];
+	fs::path outputDir = argv[2];
+	FormatChoice choice = FormatChoice::Auto;
+	bool srgb = false;
+	for (int i = 3; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--srgb") == 0)
+		{
+			srgb = true;
+		}
+		else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+		{
+			std::string name = argv[++i];
+			if (name == "auto") choice = FormatChoice::Auto;
+			else if (name == "bc1") choice = FormatChoice::BC1;
+			else if (name == "bc3") choice = FormatChoice::BC3;
+			else if (name == "bc7") choice = FormatChoice::BC7;
+			else
+			{
+				PrintUsage();
+				return 1;
+			}
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	std::error_code error;
+	if (!fs::is_directory(inputDir, error))
+	{
+		std::cout << "ERROR::TEXBAKE::NOT_A_DIRECTORY " << inputDir.string() << std::endl;
+		return 1;
+	}
+	fs::create_directories(outputDir, error);
+
+	int baked = 0;
+	int failed = 0;
+	for (const fs::directory_entry& entry : fs::directory_iterator(inputDir))
+	{
+		if (!entry.is_regular_file() || !IsImageFile(entry.path()))
+		{
+			continue;
+		}
+		for (bool flip : { false, true })
+		{
+			fs::path output = outputDir / entry.path().stem();
+			output += flip ? ".flip.ktx2" : ".ktx2";
+			if (BakeFile(entry.path(), output, choice, srgb, flip))
+			{
+				baked++;
+			}
+			else
+			{
+				failed++;
+			}
+		}
+	}
+
+	std::cout << "Baked " << baked << " textures" << (failed ? ", " + std::to_string(failed) + " failed" : "") << std::endl;
+	return failed == 0 ? 0 : 1;
+}